@@ -0,0 +1,84 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 分块的线性分配器：按需申请块（从 4KB 起倍增到 1MB），块内顺序分配，
+// 已分配的地址在释放前始终有效，不会像 realloc 那样整体搬动。
+// arena_reset 一次性回收全部分配但保留块，处理下一个文件时直接复用。
+
+#define ARENA_BLOCK_MIN (1 << 12)
+#define ARENA_BLOCK_MAX (1 << 20)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    char data[1];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;       // 按申请顺序串起的全部块
+    ArenaBlock* current;    // 正在分配的块，之后的块在 reset 后等待复用
+    size_t bytes;           // 所有块的容量之和
+} Arena;
+
+static inline void arena_init(Arena* a) {
+    a->head = NULL;
+    a->current = NULL;
+    a->bytes = 0;
+}
+
+static inline void* arena_alloc(Arena* a, size_t size) {
+    ArenaBlock* b = a->current;
+    while (b && b->used + size > b->capacity) {
+        // 复用 reset 之前申请过的后续块
+        b = b->next;
+        if (b) b->used = 0;
+    }
+    if (!b) {
+        size_t cap = a->current ? a->current->capacity * 2 : ARENA_BLOCK_MIN;
+        if (cap > ARENA_BLOCK_MAX) cap = ARENA_BLOCK_MAX;
+        if (cap < size) cap = size;
+        b = (ArenaBlock*)malloc(sizeof(ArenaBlock) + cap);
+        if (!b) {
+            fprintf(stderr, "Arena alloc failed (%zu bytes)\n", cap);
+            exit(1);
+        }
+        b->next = NULL;
+        b->used = 0;
+        b->capacity = cap;
+        if (a->current) {
+            // 挂在最后一个块之后
+            ArenaBlock* tail = a->current;
+            while (tail->next) tail = tail->next;
+            tail->next = b;
+        } else {
+            a->head = b;
+        }
+        a->bytes += cap;
+    }
+    a->current = b;
+    void* p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+// 回收全部分配，保留已申请的块
+static inline void arena_reset(Arena* a) {
+    a->current = a->head;
+    if (a->head) a->head->used = 0;
+}
+
+static inline void arena_free(Arena* a) {
+    ArenaBlock* b = a->head;
+    while (b) {
+        ArenaBlock* next = b->next;
+        free(b);
+        b = next;
+    }
+    arena_init(a);
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "radix_sort.h"
+
+// 排序引擎的基准测试：用随机键和偏斜的次数生成条目，比较原来的三种排序
+// （串行版的 qsort、MPI 版逐层 malloc 的归并排序、OpenMP 版的任务归并排序）
+// 与 radix_sort.h 的串行/并行版本，并校验结果一致。
+// 编译: g++ -O2 -fopenmp bench_sort.cpp -o bench_sort
+// 用法: ./bench_sort [条目数] [键长]
+
+#define MAX_KEY_LEN 33
+
+typedef struct {
+    char key[MAX_KEY_LEN];
+    int count;
+} FixedEntry;
+
+int compare_entries(const void* a, const void* b) {
+    const FixedEntry* ea = (const FixedEntry*)a;
+    const FixedEntry* eb = (const FixedEntry*)b;
+    if (ea->count != eb->count) return eb->count - ea->count;
+    return strcmp(ea->key, eb->key);
+}
+
+int cmp_value(const FixedEntry* a, const FixedEntry* b) {
+    return compare_entries(a, b);
+}
+
+void merge_entries(FixedEntry* arr, int left, int mid, int right) {
+    int n1 = mid - left + 1;
+    int n2 = right - mid;
+    FixedEntry* L = (FixedEntry*)malloc(n1 * sizeof(FixedEntry));
+    FixedEntry* R = (FixedEntry*)malloc(n2 * sizeof(FixedEntry));
+    for (int i = 0; i < n1; i++) L[i] = arr[left + i];
+    for (int j = 0; j < n2; j++) R[j] = arr[mid + 1 + j];
+    int i = 0, j = 0, k = left;
+    while (i < n1 && j < n2) {
+        if (cmp_value(&L[i], &R[j]) <= 0) arr[k++] = L[i++];
+        else arr[k++] = R[j++];
+    }
+    while (i < n1) arr[k++] = L[i++];
+    while (j < n2) arr[k++] = R[j++];
+    free(L);
+    free(R);
+}
+
+void merge_sort(FixedEntry* arr, int l, int r) {
+    if (l < r) {
+        int m = l + (r - l) / 2;
+        merge_sort(arr, l, m);
+        merge_sort(arr, m + 1, r);
+        merge_entries(arr, l, m, r);
+    }
+}
+
+void merge(SortEntry* arr, int l, int m, int r, SortEntry* temp) {
+    int i = l, j = m + 1, k = l;
+    while (i <= m && j <= r) {
+        if (arr[i].count > arr[j].count ||
+           (arr[i].count == arr[j].count && strcmp(arr[i].key, arr[j].key) < 0)) {
+            temp[k++] = arr[i++];
+        } else {
+            temp[k++] = arr[j++];
+        }
+    }
+    while (i <= m) temp[k++] = arr[i++];
+    while (j <= r) temp[k++] = arr[j++];
+    for (i = l; i <= r; i++) arr[i] = temp[i];
+}
+
+void parallel_merge_sort(SortEntry* arr, int l, int r, SortEntry* temp) {
+    if (l >= r) return;
+    int m = (l + r) / 2;
+    #pragma omp task shared(arr, temp) if (r-l > 1000)
+    parallel_merge_sort(arr, l, m, temp);
+    #pragma omp task shared(arr, temp) if (r-l > 1000)
+    parallel_merge_sort(arr, m+1, r, temp);
+    #pragma omp taskwait
+    merge(arr, l, m, r, temp);
+}
+
+// 次数近似 Zipf 分布：大多数键出现 1 次，少数键次数很高
+static int skewed_count(unsigned int r) {
+    double u = (r % 1000000 + 1) / 1000000.0;
+    return (int)(1.0 / (u * u)) % 100000 + 1;
+}
+
+static int same_order(const SortEntry* a, const SortEntry* b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i].count != b[i].count || strcmp(a[i].key, b[i].key) != 0) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 4000000;
+    int len = argc > 2 ? atoi(argv[2]) : 16;
+    if (len < 1 || len >= MAX_KEY_LEN) len = 16;
+
+    FixedEntry* fixed = (FixedEntry*)malloc(sizeof(FixedEntry) * n);
+    unsigned int seed = 12345;
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < len; c++) {
+            seed = seed * 1103515245u + 12345u;
+            fixed[i].key[c] = 'a' + (seed >> 16) % 26;
+        }
+        fixed[i].key[len] = '\0';
+        seed = seed * 1103515245u + 12345u;
+        fixed[i].count = skewed_count(seed >> 8);
+    }
+
+    SortEntry* base = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    for (int i = 0; i < n; i++) {
+        base[i].key = fixed[i].key;
+        base[i].count = fixed[i].count;
+    }
+    SortEntry* work = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    SortEntry* expect = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    FixedEntry* fixed_work = (FixedEntry*)malloc(sizeof(FixedEntry) * n);
+
+    printf("entries %d, key length %d, threads %d\n", n, len, omp_get_max_threads());
+
+    memcpy(fixed_work, fixed, sizeof(FixedEntry) * n);
+    double t = omp_get_wtime();
+    qsort(fixed_work, n, sizeof(FixedEntry), compare_entries);
+    double t_qsort = omp_get_wtime() - t;
+    for (int i = 0; i < n; i++) {
+        expect[i].key = fixed_work[i].key;
+        expect[i].count = fixed_work[i].count;
+    }
+
+    memcpy(fixed_work, fixed, sizeof(FixedEntry) * n);
+    t = omp_get_wtime();
+    merge_sort(fixed_work, 0, n - 1);
+    double t_merge = omp_get_wtime() - t;
+
+    memcpy(work, base, sizeof(SortEntry) * n);
+    SortEntry* temp = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    t = omp_get_wtime();
+    #pragma omp parallel
+    {
+        #pragma omp single nowait
+        parallel_merge_sort(work, 0, n - 1, temp);
+    }
+    double t_task = omp_get_wtime() - t;
+    free(temp);
+    int ok_task = same_order(work, expect, n);
+
+    memcpy(work, base, sizeof(SortEntry) * n);
+    t = omp_get_wtime();
+    sort_by_count(work, n);
+    double t_radix = omp_get_wtime() - t;
+    int ok_radix = same_order(work, expect, n);
+
+    memcpy(work, base, sizeof(SortEntry) * n);
+    t = omp_get_wtime();
+    parallel_sort_by_count(work, n);
+    double t_parallel = omp_get_wtime() - t;
+    int ok_parallel = same_order(work, expect, n);
+
+    printf("%-28s%10.3f s\n", "qsort (serial)", t_qsort);
+    printf("%-28s%10.3f s\n", "merge_sort (mpi)", t_merge);
+    printf("%-28s%10.3f s  %s\n", "task merge sort (omp)", t_task, ok_task ? "ok" : "MISMATCH");
+    printf("%-28s%10.3f s  %s\n", "sort_by_count", t_radix, ok_radix ? "ok" : "MISMATCH");
+    printf("%-28s%10.3f s  %s\n", "parallel_sort_by_count", t_parallel, ok_parallel ? "ok" : "MISMATCH");
+
+    free(fixed);
+    free(fixed_work);
+    free(base);
+    free(work);
+    free(expect);
+    return ok_task && ok_radix && ok_parallel ? 0 : 1;
+}
@@ -0,0 +1,380 @@
+import argparse
+import csv
+import datetime
+import glob
+import hashlib
+import json
+import os
+import platform
+import re
+import shlex
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+from benchmark import TIME_RE, count_lines
+from gen_dataset import generate, parse_count
+
+# 基准测试套件：在一组输入上按线程数/进程数的组合运行各后端（统一入口 groupby），
+# 每次运行只处理一个文件，记录：
+#   wall       程序自己报告的该文件耗时（秒）
+#   elapsed    进程从启动到退出的墙钟时间，含 MPI 启动
+#   throughput 行/秒（按 wall 计算）
+#   peak_rss   最大的单个进程的峰值常驻内存（MB；MPI 为单个 rank），取法见 run_once
+#   phases     程序打印的各阶段耗时（如 OpenMP 后端的 map/parse+count/merge/sort/write）
+#   stats      给出 --stats 时附上程序的统计报告（groupby 需以 -DGROUPBY_STATS 编译，见 stats.h）
+# 以及同一后端、同一输入上相对最少工作者（ranks × threads）的强扩展效率；
+# 给出 --weak-lines 时另外为每个工作者数 p 生成 p × N 行的输入，计算弱扩展效率。
+# 结果写成 JSON（含机器信息和参数）和/或 CSV，便于在不同版本之间对比。
+#
+# 用法:
+#   mpic++ -O2 -fopenmp groupby.cpp -o groupby
+#   python3 bench_suite.py --threads 1,2,4,8 --ranks 1,2,4 --json bench.json --csv bench.csv
+#   python3 bench_suite.py --generate 8x1M,24x10M --zipf 1.1 --engines omp,hybrid
+#   python3 bench_suite.py --weak-lines 1M --engines omp --threads 1,2,4,8
+
+ENGINES = ("serial", "omp", "mpi", "hybrid")
+PHASE_RE = re.compile(r"^\s+((?:[a-z][\w+]* [\d.]+\s*){2,})$")
+PHASE_PAIR_RE = re.compile(r"([a-z][\w+]*) ([\d.]+)")
+SHAPE_RE = re.compile(r"^(\d+)x(\w+)$")
+RSS_POLL = 0.01
+
+
+def int_list(text):
+    return [int(x) for x in text.split(",") if x]
+
+
+def configurations(engines, threads, ranks):
+    """(后端, 进程数, 每进程线程数) 的全部组合"""
+    configs = []
+    for engine in engines:
+        if engine == "serial":
+            configs.append((engine, 1, 1))
+        elif engine == "omp":
+            configs += [(engine, 1, t) for t in threads]
+        elif engine == "mpi":
+            configs += [(engine, r, 1) for r in ranks]
+        else:
+            configs += [(engine, r, t) for r in ranks for t in threads]
+    return configs
+
+
+def command(args, engine, ranks, threads, input_path, output_path, stats_path):
+    cmd = [args.groupby, "--backend", engine, "--input", input_path, "--output", output_path]
+    if args.stats:
+        cmd += ["--stats", stats_path]
+    if engine in ("omp", "hybrid") or (engine == "mpi" and threads > 1):
+        cmd += ["--threads", str(threads)]
+    cmd += shlex.split(args.extra)
+    if engine in ("mpi", "hybrid"):
+        cmd = shlex.split(args.mpirun) + ["-np", str(ranks)] + cmd
+    return cmd
+
+
+def proc_tree(pid):
+    """pid 及其全部后代进程（按 /proc/*/stat 中的父进程号）"""
+    children = {}
+    for entry in os.listdir("/proc"):
+        if not entry.isdigit():
+            continue
+        try:
+            with open(f"/proc/{entry}/stat") as f:
+                ppid = int(f.read().rsplit(")", 1)[1].split()[1])
+        except (OSError, IndexError, ValueError):
+            continue
+        children.setdefault(ppid, []).append(int(entry))
+    tree, todo = [], [pid]
+    while todo:
+        p = todo.pop()
+        tree.append(p)
+        todo += children.get(p, [])
+    return tree
+
+
+def vm_hwm_kb(pid):
+    """进程的峰值常驻内存（/proc/<pid>/status 的 VmHWM，KB），进程已退出时为 0"""
+    try:
+        with open(f"/proc/{pid}/status") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return 0
+
+
+def fork_baseline_kb(env):
+    """用与 run_once 相同的方式启动 /bin/true 得到的 ru_maxrss（KB），即 fork 时本进程的 RSS"""
+    proc = subprocess.Popen(["/bin/true"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, env=env)
+    _, _, usage = os.wait4(proc.pid, 0)
+    return usage.ru_maxrss
+
+
+def run_once(cmd, env):
+    """运行一次，返回 (程序报告的耗时, 进程墙钟时间, 峰值 RSS MB, 各阶段耗时, 退出码)
+
+    Linux 上 fork 出的子进程的 ru_maxrss 从 fork 时本 Python 进程的 RSS 算起，
+    实际峰值低于它时只能看到 Python 自己的占用。因此先用同样的方式运行 /bin/true 得到这个底数：
+    ru_maxrss 高于底数时就是真实的峰值；否则改用运行期间每 RSS_POLL 秒采样一次的
+    各进程（含 MPI 的各 rank）VmHWM 中的最大值。进程在第一次采样之前就已退出时
+    只能给出 ru_maxrss，它是峰值的上界"""
+    baseline_kb = fork_baseline_kb(env)
+
+    sampled = {"kb": 0}
+    done = threading.Event()
+
+    def sample(pid):
+        while not done.is_set():
+            for p in proc_tree(pid):
+                sampled["kb"] = max(sampled["kb"], vm_hwm_kb(p))
+            done.wait(RSS_POLL)
+
+    with tempfile.TemporaryFile(mode="w+") as out:
+        start = time.monotonic()
+        proc = subprocess.Popen(cmd, stdout=out, stderr=subprocess.STDOUT, env=env)
+        sampler = threading.Thread(target=sample, args=(proc.pid,), daemon=True)
+        sampler.start()
+        # wait4 给出该子进程及其已回收的后代（mpirun 下的各 rank）的资源统计
+        _, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.monotonic() - start
+        done.set()
+        sampler.join()
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        out.seek(0)
+        text = out.read()
+    peak_kb = usage.ru_maxrss
+    if peak_kb <= baseline_kb and sampled["kb"] > 0:
+        peak_kb = sampled["kb"]
+
+    wall = None
+    phases = {}
+    for line in text.splitlines():
+        m = TIME_RE.search(line)
+        if m:
+            wall = float(m.group(1))
+            continue
+        m = PHASE_RE.match(line)
+        if m:
+            for name, value in PHASE_PAIR_RE.findall(m.group(1)):
+                phases[name] = phases.get(name, 0.0) + float(value)
+    if proc.returncode != 0:
+        print(f"warning: {' '.join(cmd)} exited with {proc.returncode}\n{text}", file=sys.stderr)
+    return wall, elapsed, peak_kb / 1024.0, phases, proc.returncode
+
+
+def file_digest(path):
+    h = hashlib.md5()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            h.update(block)
+    return h.hexdigest()
+
+
+def generated_path(args, key_len, lines):
+    name = f"gen_{key_len}_{lines}_d{args.distinct_ratio:g}_z{args.zipf:g}_s{args.seed}.txt"
+    return os.path.join(args.gen_dir, name)
+
+
+def ensure_generated(args, key_len, lines):
+    path = generated_path(args, key_len, lines)
+    if not os.path.exists(path):
+        print(f"generating {path}", file=sys.stderr)
+        generate(path, lines, key_len, args.distinct_ratio, args.zipf, args.seed)
+    return path
+
+
+def strong_inputs(args):
+    if args.inputs:
+        return args.inputs
+    if args.generate:
+        paths = []
+        for shape in args.generate.split(","):
+            m = SHAPE_RE.match(shape)
+            if not m:
+                sys.exit(f"bad shape {shape!r}, expected KEYLENxLINES such as 16x10M")
+            paths.append(ensure_generated(args, int(m.group(1)), parse_count(m.group(2))))
+        return paths
+    return sorted(glob.glob("dataset/data_*.txt"))
+
+
+def run_matrix(args, jobs, env, line_counts):
+    """jobs 为 (场景, 后端, 进程数, 线程数, 输入) 列表，每项重复 args.repeat 次"""
+    runs = []
+    digests = {}
+    with tempfile.TemporaryDirectory(dir=args.work_dir) as work:
+        output_path = os.path.join(work, "result.txt")
+        stats_path = os.path.join(work, "stats.json")
+        for scenario, engine, ranks, threads, path in jobs:
+            if path not in line_counts:
+                line_counts[path] = count_lines(path)
+            lines = line_counts[path]
+            cmd = command(args, engine, ranks, threads, path, output_path, stats_path)
+            for rep in range(args.repeat):
+                wall, elapsed, rss, phases, rc = run_once(cmd, env)
+                t = wall if wall is not None else elapsed
+                record = {
+                    "scenario": scenario, "engine": engine, "ranks": ranks, "threads": threads,
+                    "workers": ranks * threads, "input": path, "lines": lines, "repeat": rep,
+                    "wall": t, "elapsed": elapsed, "throughput": lines / t if t > 0 else None,
+                    "peak_rss_mb": rss, "phases": phases, "exit_code": rc,
+                }
+                if args.stats and rc == 0 and os.path.exists(stats_path):
+                    with open(stats_path) as f:
+                        record["stats"] = json.load(f)
+                    os.remove(stats_path)
+                if args.verify and rc == 0 and rep == 0:
+                    d = file_digest(output_path)
+                    expected = digests.setdefault(path, d)
+                    record["verified"] = d == expected
+                    if d != expected:
+                        print(f"warning: {engine} r={ranks} t={threads} output differs on {path}",
+                              file=sys.stderr)
+                runs.append(record)
+                print(f"{scenario:<7}{engine:<8}r={ranks:<3}t={threads:<3}{os.path.basename(path):<32}"
+                      f"{t:>9.3f}s {lines / t if t > 0 else 0:>14.0f} lines/s {rss:>9.1f} MB",
+                      file=sys.stderr)
+    return runs
+
+
+def summarize(runs, line_counts, key_lens):
+    """每个 (场景, 后端, 进程数, 线程数, 输入) 取各次重复的中位数，再计算扩展效率"""
+    groups = {}
+    for r in runs:
+        if r["exit_code"] != 0:
+            continue
+        key = (r["scenario"], r["engine"], r["ranks"], r["threads"], r["input"])
+        groups.setdefault(key, []).append(r)
+
+    summary = []
+    for (scenario, engine, ranks, threads, path), rs in groups.items():
+        phases = {}
+        for name in rs[0]["phases"]:
+            phases[name] = statistics.median(r["phases"].get(name, 0.0) for r in rs)
+        wall = statistics.median(r["wall"] for r in rs)
+        summary.append({
+            "scenario": scenario, "engine": engine, "ranks": ranks, "threads": threads,
+            "workers": ranks * threads, "input": path, "lines": line_counts[path],
+            "wall": wall, "throughput": line_counts[path] / wall if wall > 0 else None,
+            "peak_rss_mb": max(r["peak_rss_mb"] for r in rs), "phases": phases,
+        })
+        if scenario == "weak":
+            summary[-1]["key_len"] = key_lens[path]
+
+    # 强扩展：同一后端、同一输入，以工作者最少的配置为基准，E = T0·p0 / (T·p)
+    # 弱扩展：同一后端、同一键长，输入行数与 p 成正比，E = T0 / T
+    for s in summary:
+        if s["scenario"] == "strong":
+            peers = [x for x in summary if x["scenario"] == "strong" and x["engine"] == s["engine"]
+                     and x["input"] == s["input"]]
+            base = min(peers, key=lambda x: x["workers"])
+            s["speedup"] = base["wall"] / s["wall"] if s["wall"] > 0 else None
+            s["strong_efficiency"] = (base["wall"] * base["workers"] / (s["wall"] * s["workers"])
+                                      if s["wall"] > 0 else None)
+        else:
+            peers = [x for x in summary if x["scenario"] == "weak" and x["engine"] == s["engine"]
+                     and x["key_len"] == s["key_len"]]
+            base = min(peers, key=lambda x: x["workers"])
+            s["weak_efficiency"] = base["wall"] / s["wall"] if s["wall"] > 0 else None
+    return summary
+
+
+def write_csv(path, summary):
+    phase_names = []
+    for s in summary:
+        for name in s["phases"]:
+            if name not in phase_names:
+                phase_names.append(name)
+    fields = ["scenario", "engine", "ranks", "threads", "workers", "input", "lines", "wall",
+              "throughput", "peak_rss_mb", "speedup", "strong_efficiency", "weak_efficiency"]
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(fields + ["phase_" + p for p in phase_names])
+        for s in summary:
+            w.writerow([s.get(k, "") for k in fields] + [s["phases"].get(p, "") for p in phase_names])
+
+
+def git_commit():
+    try:
+        return subprocess.run(["git", "rev-parse", "HEAD"], capture_output=True, text=True,
+                              check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description="run every engine over thread/rank counts")
+    ap.add_argument("--groupby", default="./groupby", help="unified binary built from groupby.cpp")
+    ap.add_argument("--mpirun", default="mpirun", help="launcher for mpi/hybrid, e.g. 'mpirun --oversubscribe'")
+    ap.add_argument("--engines", default=",".join(ENGINES))
+    ap.add_argument("--threads", default="1,2,4,8", help="thread counts for omp/hybrid")
+    ap.add_argument("--ranks", default="1,2,4", help="rank counts for mpi/hybrid")
+    ap.add_argument("--inputs", nargs="*", help="input files (default dataset/data_*.txt)")
+    ap.add_argument("--generate", help="generate inputs of these shapes, e.g. 8x1M,16x10M")
+    ap.add_argument("--weak-lines", help="also run weak scaling with this many lines per worker")
+    ap.add_argument("--weak-key-lens", default="8,16,24", help="key lengths for weak scaling")
+    ap.add_argument("--distinct-ratio", type=float, default=0.1)
+    ap.add_argument("--zipf", type=float, default=0.0)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--gen-dir", default="bench_data", help="cache for generated inputs")
+    ap.add_argument("--work-dir", default=None, help="where temporary outputs are written")
+    ap.add_argument("--repeat", type=int, default=3)
+    ap.add_argument("--extra", default="", help="extra arguments for every run, e.g. '--shuffle'")
+    ap.add_argument("--verify", action="store_true", help="check that every run writes the same output")
+    ap.add_argument("--stats", action="store_true",
+                    help="attach each run's --stats report (groupby built with -DGROUPBY_STATS)")
+    ap.add_argument("--json", help="write runs and summary as JSON")
+    ap.add_argument("--csv", help="write the summary as CSV")
+    args = ap.parse_args(argv)
+
+    engines = [e for e in args.engines.split(",") if e]
+    for e in engines:
+        if e not in ENGINES:
+            ap.error(f"unknown engine {e}")
+    configs = configurations(engines, int_list(args.threads), int_list(args.ranks))
+
+    # 线程数由 --threads 控制，避免外部的 OMP_NUM_THREADS 干扰
+    env = dict(os.environ)
+    env.pop("OMP_NUM_THREADS", None)
+
+    jobs = [("strong", e, r, t, path) for path in strong_inputs(args) for e, r, t in configs]
+    key_lens = {}
+    if args.weak_lines:
+        per_worker = parse_count(args.weak_lines)
+        for k in int_list(args.weak_key_lens):
+            for e, r, t in configs:
+                path = ensure_generated(args, k, per_worker * r * t)
+                key_lens[path] = k
+                jobs.append(("weak", e, r, t, path))
+    if not jobs:
+        ap.error("no inputs: put datasets in dataset/, or use --inputs / --generate")
+
+    line_counts = {}
+    runs = run_matrix(args, jobs, env, line_counts)
+    summary = summarize(runs, line_counts, key_lens)
+
+    print(f"{'scenario':<9}{'engine':<8}{'ranks':>6}{'threads':>8}  {'input':<34}{'wall s':>9}"
+          f"{'lines/s':>14}{'RSS MB':>9}{'eff':>7}")
+    for s in summary:
+        eff = s.get("strong_efficiency", s.get("weak_efficiency"))
+        print(f"{s['scenario']:<9}{s['engine']:<8}{s['ranks']:>6}{s['threads']:>8}  "
+              f"{os.path.basename(s['input']):<34}{s['wall']:>9.3f}{s['throughput'] or 0:>14.0f}"
+              f"{s['peak_rss_mb']:>9.1f}{eff if eff is not None else 0:>7.2f}")
+
+    if args.json:
+        meta = {
+            "date": datetime.datetime.now().isoformat(timespec="seconds"),
+            "host": platform.node(), "platform": platform.platform(),
+            "cpus": os.cpu_count(), "commit": git_commit(), "args": vars(args),
+        }
+        with open(args.json, "w") as f:
+            json.dump({"meta": meta, "runs": runs, "summary": summary}, f, indent=2)
+    if args.csv:
+        write_csv(args.csv, summary)
+    return 1 if any(r["exit_code"] != 0 for r in runs) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,91 @@
+import re
+import shlex
+import subprocess
+import sys
+
+# 在 data_{8,16,24} × {1M,10M,40M} 上运行各版本程序，统计每个文件的吞吐量（行/秒）。
+# 各程序会逐个文件打印 "Processing...: 输入 -> 输出" 和耗时，这里解析这些输出。
+#
+# 用法: python3 benchmark.py [名称=命令 ...]
+#   例: python3 benchmark.py old=./chuanxing_old new=./chuanxing
+# 第一个程序作为基准，其余程序额外给出相对它的加速比。
+
+DEFAULT_ENGINES = [
+    ("serial", "./chuanxing"),
+    ("omp", "./omp_exam"),
+    ("mpi", "mpirun -np 4 ./mpi_exam"),
+]
+
+PROCESSING_RE = re.compile(r"Processing(?: file)?: (\S+) -> (\S+)")
+TIME_RE = re.compile(r"(?:Time:|processed in) ([\d.]+) seconds")
+
+
+def count_lines(path):
+    """统计输入文件行数"""
+    n = 0
+    with open(path, "rb") as f:
+        while True:
+            buf = f.read(1 << 20)
+            if not buf:
+                break
+            n += buf.count(b"\n")
+    return n
+
+
+def run_engine(cmd):
+    """运行一个程序，返回 {输入文件: 耗时}"""
+    proc = subprocess.run(shlex.split(cmd), capture_output=True, text=True)
+    times = {}
+    current = None
+    for line in proc.stdout.splitlines():
+        m = PROCESSING_RE.search(line)
+        if m:
+            current = m.group(1)
+            continue
+        m = TIME_RE.search(line)
+        if m and current:
+            times[current] = float(m.group(1))
+            current = None
+    if proc.returncode != 0:
+        print(f"警告: {cmd} 退出码 {proc.returncode}", file=sys.stderr)
+    return times
+
+
+def main(argv):
+    engines = []
+    for arg in argv:
+        name, _, cmd = arg.partition("=")
+        engines.append((name, cmd))
+    if not engines:
+        engines = DEFAULT_ENGINES
+
+    results = [(name, run_engine(cmd)) for name, cmd in engines]
+
+    inputs = []
+    for _, times in results:
+        for path in times:
+            if path not in inputs:
+                inputs.append(path)
+
+    header = f"{'dataset':<28}{'lines':>12}"
+    for name, _ in results:
+        header += f"{name + ' lines/s':>20}"
+    for name, _ in results[1:]:
+        header += f"{name + ' speedup':>18}"
+    print(header)
+
+    for path in inputs:
+        lines = count_lines(path)
+        row = f"{path:<28}{lines:>12}"
+        for _, times in results:
+            t = times.get(path)
+            row += f"{lines / t:>20.0f}" if t else f"{'-':>20}"
+        base = results[0][1].get(path)
+        for _, times in results[1:]:
+            t = times.get(path)
+            row += f"{base / t:>17.2f}x" if base and t else f"{'-':>18}"
+        print(row)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,215 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hash_table.h"
+#include "mmap_reader.h"
+
+// 增量模式（--incremental）：输入是只追加的日志。每次处理完，把聚合后的全部 (键, 次数)
+// 连同已消费的字节数写入输出文件旁的状态文件 <output>.state；下次只解析新增的尾部，
+// 把保存的状态累加进计数表后重新排序输出，解析的代价只与新增的字节数有关。
+// 只消费到最后一个换行符为止：末尾还没写完的半行照常计入本次输出，但不写入状态，
+// 下次连同补全的部分一起解析。
+// 状态中记录输入的设备号、inode，以及文件开头和消费位置之前各 CHECKPOINT_TAIL 字节；
+// 文件被截断、替换或从头改写时对不上，自动回退为从头统计（中间的改动检查不出来）。
+// 记录格式与 spill.h 的段相同：1 字节键长 + 键 + int 次数。读取时整个映射进来解析，
+// 写出时先拼进缓冲区再成块写入临时文件，每次写入都检查，fsync 之后才 rename，
+// 中途任何一步失败都删掉临时文件，原来的状态保持不变。
+
+#define CHECKPOINT_MAGIC "GBSTATE1"
+#define CHECKPOINT_TAIL 64
+#define CHECKPOINT_IO_BUFFER (1 << 20)
+
+typedef struct {
+    char magic[8];
+    unsigned long long dev;
+    unsigned long long ino;
+    unsigned long long offset;      // 已计入状态的字节数，总在行首
+    long long entries;
+    unsigned int tail_len;
+    char head[CHECKPOINT_TAIL];     // 文件开头的 tail_len 字节
+    char tail[CHECKPOINT_TAIL];     // offset 之前的最后 tail_len 字节
+} CheckpointHeader;
+
+typedef struct {
+    FILE* f;
+    char* buf;
+    size_t used;
+    int error;                      // 第一次写入失败的 errno，0 表示还没有失败
+    CheckpointHeader header;
+    char path[4096];
+    char tmp[4096 + 8];
+} CheckpointWriter;
+
+static inline void checkpoint_path(const char* output, char* path, size_t n) {
+    snprintf(path, n, "%s.state", output);
+}
+
+static inline int checkpoint_identity(const char* input, CheckpointHeader* h) {
+    struct stat st;
+    if (stat(input, &st) != 0) return -1;
+    h->dev = (unsigned long long)st.st_dev;
+    h->ino = (unsigned long long)st.st_ino;
+    return 0;
+}
+
+// offset 之后最后一个完整行的结尾（最后一个换行符之后）；没有完整的行时为 offset
+static inline size_t checkpoint_line_end(const MappedFile* f, size_t offset) {
+    if (offset >= f->size) return f->size;
+    const char* nl = (const char*)memrchr(f->data + offset, '\n', f->size - offset);
+    return nl ? (size_t)(nl - f->data) + 1 : offset;
+}
+
+// 末尾没有换行符的半行 [end, f->size)：按 line_reader_next 的规则作为一个键返回 1，
+// 没有或超长时返回 0
+static inline int checkpoint_partial_line(const MappedFile* f, size_t end, KeySlice* key) {
+    if (end >= f->size || f->size - end >= MAX_KEY_LEN) return 0;
+    key->ptr = f->data + end;
+    key->len = f->size - end;
+    return 1;
+}
+
+// 映射 output 对应的状态并核对输入 f 是否只是在其后追加了内容。可以续用时返回 0，
+// 状态映射在 *state 中，头部为 *checkpoint_header(state)；没有状态或状态已失效时返回 -1，
+// 应从头统计
+static inline int checkpoint_open(const char* output, const char* input, const MappedFile* f,
+                                  MappedFile* state) {
+    char path[4096];
+    checkpoint_path(output, path, sizeof(path));
+    if (map_file(path, state) != 0) return -1;
+
+    const CheckpointHeader* h = (const CheckpointHeader*)state->data;
+    CheckpointHeader cur;
+    bool ok = state->size >= sizeof(*h) &&
+              memcmp(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic)) == 0 &&
+              checkpoint_identity(input, &cur) == 0 && h->dev == cur.dev && h->ino == cur.ino &&
+              h->offset <= f->size && h->tail_len <= CHECKPOINT_TAIL && h->tail_len <= h->offset &&
+              (h->tail_len == 0 || (memcmp(h->head, f->data, h->tail_len) == 0 &&
+                                    memcmp(h->tail, f->data + h->offset - h->tail_len, h->tail_len) == 0));
+    if (!ok) {
+        fprintf(stderr, "State %s does not match %s, counting from the start\n", path, input);
+        unmap_file(state);
+        return -1;
+    }
+    return 0;
+}
+
+static inline const CheckpointHeader* checkpoint_header(const MappedFile* state) {
+    return (const CheckpointHeader*)state->data;
+}
+
+// 把状态中的记录按 hash_shard 累加进 shards[0..n)（与 omp_tables.h 的分片规则一致），
+// 读完解除映射。记录不全时返回 -1
+static inline int checkpoint_load(MappedFile* state, HashMap* const* shards, int n) {
+    long long entries = checkpoint_header(state)->entries;
+    const char* p = state->data + sizeof(CheckpointHeader);
+    const char* end = state->data + state->size;
+    int rc = 0;
+    for (long long i = 0; i < entries; i++) {
+        size_t len = p < end ? (unsigned char)*p : MAX_KEY_LEN;
+        if (len >= MAX_KEY_LEN || (size_t)(end - p) < 1 + len + sizeof(int)) {
+            rc = -1;
+            break;
+        }
+        const char* key = p + 1;
+        int count;
+        memcpy(&count, key + len, sizeof(int));
+        p = key + len + sizeof(int);
+        unsigned int hash = hash_string(key, len);
+        hashmap_add_hashed(shards[hash_shard(hash, n)], key, len, hash, count);
+    }
+    unmap_file(state);
+    return rc;
+}
+
+// 开始写 output 对应的新状态：输入 f 的前 offset 字节已全部计入。失败返回 -1（errno 保留）
+static inline int checkpoint_create(CheckpointWriter* w, const char* output, const char* input,
+                                    const MappedFile* f, size_t offset) {
+    CheckpointHeader* h = &w->header;
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic));
+    if (checkpoint_identity(input, h) != 0) return -1;
+    h->offset = offset;
+    h->tail_len = offset < CHECKPOINT_TAIL ? (unsigned int)offset : CHECKPOINT_TAIL;
+    if (h->tail_len > 0) {
+        memcpy(h->head, f->data, h->tail_len);
+        memcpy(h->tail, f->data + offset - h->tail_len, h->tail_len);
+    }
+
+    checkpoint_path(output, w->path, sizeof(w->path));
+    snprintf(w->tmp, sizeof(w->tmp), "%s.tmp", w->path);
+    w->f = fopen(w->tmp, "wb");
+    if (!w->f) return -1;
+    // 条目数最后补写，先占住头部的位置
+    w->buf = (char*)malloc(CHECKPOINT_IO_BUFFER);
+    if (!w->buf) {
+        fclose(w->f);
+        remove(w->tmp);
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(w->buf, h, sizeof(*h));
+    w->used = sizeof(*h);
+    w->error = 0;
+    return 0;
+}
+
+// 把缓冲区写入临时文件，写不满时记下 errno，之后的写入都跳过
+static inline void checkpoint_flush(CheckpointWriter* w) {
+    if (!w->error && fwrite(w->buf, 1, w->used, w->f) != w->used) w->error = errno ? errno : EIO;
+    w->used = 0;
+}
+
+static inline void checkpoint_put(CheckpointWriter* w, const char* key, size_t len, int count) {
+    if (w->used + 1 + len + sizeof(int) > CHECKPOINT_IO_BUFFER) checkpoint_flush(w);
+    char* p = w->buf + w->used;
+    p[0] = (char)len;
+    memcpy(p + 1, key, len);
+    memcpy(p + 1 + len, &count, sizeof(int));
+    w->used += 1 + len + sizeof(int);
+    w->header.entries++;
+}
+
+// 补写条目数，落盘后替换旧状态。失败返回 -1（errno 保留），临时文件删除，旧状态保持不变
+static inline int checkpoint_commit(CheckpointWriter* w) {
+    checkpoint_flush(w);
+    free(w->buf);
+    w->buf = NULL;
+    int err = w->error;
+    if (!err && (fseek(w->f, 0, SEEK_SET) != 0 ||
+                 fwrite(&w->header, sizeof(w->header), 1, w->f) != 1 ||
+                 fflush(w->f) != 0 || fsync(fileno(w->f)) != 0)) {
+        err = errno ? errno : EIO;
+    }
+    if (fclose(w->f) != 0 && !err) err = errno;
+    w->f = NULL;
+    if (!err && rename(w->tmp, w->path) != 0) err = errno;
+    if (err) {
+        remove(w->tmp);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+// 把 tables[0..n) 中的全部条目写成 output 的状态
+static inline int checkpoint_save_tables(const char* output, const char* input, const MappedFile* f,
+                                         size_t offset, HashMap* const* tables, int n) {
+    CheckpointWriter w;
+    if (checkpoint_create(&w, output, input, f, offset) != 0) return -1;
+    for (int p = 0; p < n; p++) {
+        for (unsigned int i = 0; i < tables[p]->capacity; i++) {
+            const Slot* s = &tables[p]->slots[i];
+            if (s->key) checkpoint_put(&w, s->key, strlen(s->key), s->count);
+        }
+    }
+    return checkpoint_commit(&w);
+}
+
+#endif
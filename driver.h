@@ -0,0 +1,297 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glob.h>
+
+// 各后端共用的命令行解析：要处理的文件列表和调优参数。
+// 文件来源（可混用，按出现顺序处理）：
+//   --input 文件 [--output 文件]   单个文件，省略输出时写到 --output-dir 下
+//   --glob 模式                   匹配到的所有文件
+//   --manifest 清单               每行 "输入 [输出]"，空行和 # 开头的行忽略
+// 一个都没给时处理 dataset/ 下的 9 个数据集，结果写到 output/（与原来的行为相同）。
+// 省略的输出文件名为 <output-dir>/result-<输入文件名>，--output-dir 默认为 output。
+
+typedef enum { BACKEND_SERIAL, BACKEND_OMP, BACKEND_MPI, BACKEND_HYBRID } Backend;
+
+typedef struct {
+    char* input;
+    char* output;
+} FileJob;
+
+typedef struct {
+    int backend;
+    FileJob* files;
+    int file_count;
+    int file_capacity;
+    const char* output_dir;
+    int threads;                // 每个文件（MPI/混合后端为每个进程）使用的线程数，0 表示后端默认
+    int jobs;                   // 同时处理的文件数，0 表示按可用的核自动决定
+    unsigned int table_size;    // 哈希表初始槽位数，0 表示后端默认
+    int top_k;
+    bool shuffle;
+    size_t memory_budget;
+    const char* spill_dir;
+    const char* stats_file;     // --stats：统计报告的输出文件，需以 -DGROUPBY_STATS 编译
+    int hot_keys;               // 多线程/MPI 计数前检测的热点键个数上限，0 表示不检测
+    bool approx;                // 近似模式，见 sketch.h
+    double hll_error;
+    double cm_epsilon;
+    double cm_delta;
+    bool incremental;           // 只统计上次运行之后追加的部分，见 checkpoint.h
+    bool binary;                // --format binary：输出二进制结果，见 result_file.h
+} DriverOptions;
+
+static const char* driver_default_files[][2] = {
+    {"dataset/data_8_1M.txt", "output/result8-1M.txt"},
+    {"dataset/data_8_10M.txt", "output/result8-10M.txt"},
+    {"dataset/data_8_40M.txt", "output/result8-40M.txt"},
+    {"dataset/data_16_1M.txt", "output/result16-1M.txt"},
+    {"dataset/data_16_10M.txt", "output/result16-10M.txt"},
+    {"dataset/data_16_40M.txt", "output/result16-40M.txt"},
+    {"dataset/data_24_1M.txt", "output/result24-1M.txt"},
+    {"dataset/data_24_10M.txt", "output/result24-10M.txt"},
+    {"dataset/data_24_40M.txt", "output/result24-40M.txt"}
+};
+
+// 墙钟时间（秒），多线程同时处理文件时 clock() 统计的是全部线程的 CPU 时间
+static inline double driver_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline char* driver_strdup(const char* s) {
+    size_t len = strlen(s);
+    char* d = (char*)malloc(len + 1);
+    memcpy(d, s, len + 1);
+    return d;
+}
+
+static inline void driver_add_file(DriverOptions* opt, const char* input, const char* output) {
+    if (opt->file_count >= opt->file_capacity) {
+        opt->file_capacity = opt->file_capacity ? opt->file_capacity * 2 : 16;
+        opt->files = (FileJob*)realloc(opt->files, sizeof(FileJob) * opt->file_capacity);
+    }
+    FileJob* f = &opt->files[opt->file_count++];
+    f->input = driver_strdup(input);
+    if (output) {
+        f->output = driver_strdup(output);
+    } else {
+        const char* slash = strrchr(input, '/');
+        const char* base = slash ? slash + 1 : input;
+        size_t len = strlen(opt->output_dir) + strlen(base) + 16;
+        f->output = (char*)malloc(len);
+        snprintf(f->output, len, "%s/result-%s", opt->output_dir, base);
+    }
+}
+
+static inline int driver_add_manifest(DriverOptions* opt, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char line[8192];
+    while (fgets(line, sizeof(line), f)) {
+        char* input = strtok(line, " \t\r\n");
+        if (!input || input[0] == '#') continue;
+        char* output = strtok(NULL, " \t\r\n");
+        driver_add_file(opt, input, output);
+    }
+    fclose(f);
+    return 0;
+}
+
+static inline void driver_usage(const char* prog, bool with_backend) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "%s"
+            "  --input FILE [--output FILE]  process one file (repeatable)\n"
+            "  --glob PATTERN                process every file matching PATTERN\n"
+            "  --manifest FILE               process files listed as \"input [output]\" lines\n"
+            "  --output-dir DIR              directory for outputs not given explicitly (default output)\n"
+            "  --threads N                   threads per file (mpi/hybrid: per rank)\n"
+            "  --jobs N                      files processed at the same time (0 = as cores allow)\n"
+            "  --table-size N                initial hash table slots\n"
+            "  --top-k N                     only write the N most frequent keys\n"
+            "  --shuffle                     mpi/hybrid: hash shuffle + sample sort instead of tree merge\n"
+            "  --memory-budget MB            serial: spill sorted runs when the table exceeds MB\n"
+            "  --spill-dir DIR               serial: directory for spill files (default /tmp)\n"
+            "  --hot-keys N                  omp/mpi/hybrid: count up to N sampled heavy hitters in\n"
+            "                                private counters (default 32, 0 = off)\n"
+            "  --approx                      estimate distinct keys (HyperLogLog) and the --top-k\n"
+            "                                heaviest keys (Count-Min) in constant memory\n"
+            "  --hll-error E                 approx: relative std error of the distinct count (default 0.01)\n"
+            "  --cm-epsilon E                approx: count error bound as a fraction of lines (default 0.0001)\n"
+            "  --cm-delta D                  approx: probability of exceeding that bound (default 0.01)\n"
+            "  --format text|binary          output format (default text); binary is an mmap-able\n"
+            "                                file with a key index, see result_tool\n"
+            "  --incremental                 only parse what was appended since the last run, merging\n"
+            "                                the state saved next to each output (OUTPUT.state)\n"
+            "  --stats FILE                  write per-thread/per-rank timers and counters as JSON\n"
+            "                                (- for stdout; needs a -DGROUPBY_STATS build)\n",
+            prog, with_backend ? "  --backend serial|omp|mpi|hybrid  engine to run\n" : "");
+}
+
+// 解析参数，出错时在 verbose 为真时打印用法并返回 -1。
+// with_backend 为假时不接受 --backend（单一后端的程序），backend 保持调用方给的默认值
+static inline int driver_parse(int argc, char* argv[], DriverOptions* opt, int backend,
+                               bool with_backend, bool verbose) {
+    opt->backend = backend;
+    opt->files = NULL;
+    opt->file_count = 0;
+    opt->file_capacity = 0;
+    opt->output_dir = "output";
+    opt->threads = 0;
+    opt->jobs = 0;
+    opt->table_size = 0;
+    opt->top_k = 0;
+    opt->shuffle = false;
+    opt->memory_budget = 0;
+    opt->spill_dir = "/tmp";
+    opt->stats_file = NULL;
+    opt->hot_keys = 32;
+    opt->approx = false;
+    opt->hll_error = 0.01;
+    opt->cm_epsilon = 1e-4;
+    opt->cm_delta = 0.01;
+    opt->incremental = false;
+    opt->binary = false;
+
+    // 第一遍读取普通参数，第二遍再按顺序展开文件列表，这样 --output-dir 写在哪里都生效
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--shuffle") == 0) opt->shuffle = true;
+        else if (strcmp(a, "--approx") == 0) opt->approx = true;
+        else if (strcmp(a, "--incremental") == 0) opt->incremental = true;
+        else if (strcmp(a, "--backend") == 0 && has_value && with_backend) {
+            const char* b = argv[++i];
+            if (strcmp(b, "serial") == 0) opt->backend = BACKEND_SERIAL;
+            else if (strcmp(b, "omp") == 0) opt->backend = BACKEND_OMP;
+            else if (strcmp(b, "mpi") == 0) opt->backend = BACKEND_MPI;
+            else if (strcmp(b, "hybrid") == 0) opt->backend = BACKEND_HYBRID;
+            else {
+                if (verbose) fprintf(stderr, "Unknown backend: %s\n", b);
+                return -1;
+            }
+        }
+        else if (strcmp(a, "--format") == 0 && has_value) {
+            const char* fmt = argv[++i];
+            if (strcmp(fmt, "text") == 0) opt->binary = false;
+            else if (strcmp(fmt, "binary") == 0) opt->binary = true;
+            else {
+                if (verbose) fprintf(stderr, "Unknown format: %s\n", fmt);
+                return -1;
+            }
+        }
+        else if (strcmp(a, "--output-dir") == 0 && has_value) opt->output_dir = argv[++i];
+        else if (strcmp(a, "--threads") == 0 && has_value) opt->threads = atoi(argv[++i]);
+        else if (strcmp(a, "--jobs") == 0 && has_value) opt->jobs = atoi(argv[++i]);
+        else if (strcmp(a, "--table-size") == 0 && has_value) opt->table_size = (unsigned int)atol(argv[++i]);
+        else if (strcmp(a, "--top-k") == 0 && has_value) opt->top_k = atoi(argv[++i]);
+        else if (strcmp(a, "--memory-budget") == 0 && has_value) opt->memory_budget = (size_t)(atof(argv[++i]) * (1 << 20));
+        else if (strcmp(a, "--spill-dir") == 0 && has_value) opt->spill_dir = argv[++i];
+        else if (strcmp(a, "--stats") == 0 && has_value) opt->stats_file = argv[++i];
+        else if (strcmp(a, "--hot-keys") == 0 && has_value) opt->hot_keys = atoi(argv[++i]);
+        else if (strcmp(a, "--hll-error") == 0 && has_value) opt->hll_error = atof(argv[++i]);
+        else if (strcmp(a, "--cm-epsilon") == 0 && has_value) opt->cm_epsilon = atof(argv[++i]);
+        else if (strcmp(a, "--cm-delta") == 0 && has_value) opt->cm_delta = atof(argv[++i]);
+        else if ((strcmp(a, "--input") == 0 || strcmp(a, "--output") == 0 ||
+                  strcmp(a, "--glob") == 0 || strcmp(a, "--manifest") == 0) && has_value) i++;
+        else {
+            if (verbose) {
+                fprintf(stderr, "Unknown or incomplete option: %s\n", a);
+                driver_usage(argv[0], with_backend);
+            }
+            return -1;
+        }
+    }
+
+    bool any_source = false;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strcmp(a, "--input") == 0) {
+            any_source = true;
+            const char* input = argv[++i];
+            const char* output = NULL;
+            if (i + 2 < argc && strcmp(argv[i + 1], "--output") == 0) {
+                output = argv[i + 2];
+                i += 2;
+            }
+            driver_add_file(opt, input, output);
+        } else if (strcmp(a, "--output") == 0) {
+            if (verbose) fprintf(stderr, "--output must follow --input\n");
+            return -1;
+        } else if (strcmp(a, "--glob") == 0) {
+            any_source = true;
+            glob_t g;
+            int rc = glob(argv[++i], 0, NULL, &g);
+            if (rc == 0) {
+                for (size_t k = 0; k < g.gl_pathc; k++) driver_add_file(opt, g.gl_pathv[k], NULL);
+            } else if (rc != GLOB_NOMATCH) {
+                if (verbose) fprintf(stderr, "Cannot expand glob: %s\n", argv[i]);
+                return -1;
+            }
+            globfree(&g);
+        } else if (strcmp(a, "--manifest") == 0) {
+            any_source = true;
+            if (driver_add_manifest(opt, argv[++i]) != 0) {
+                if (verbose) perror("Cannot open manifest");
+                return -1;
+            }
+        } else if (strcmp(a, "--backend") == 0 || strcmp(a, "--output-dir") == 0 ||
+                   strcmp(a, "--format") == 0 ||
+                   strcmp(a, "--threads") == 0 || strcmp(a, "--jobs") == 0 ||
+                   strcmp(a, "--table-size") == 0 || strcmp(a, "--top-k") == 0 ||
+                   strcmp(a, "--memory-budget") == 0 || strcmp(a, "--spill-dir") == 0 ||
+                   strcmp(a, "--stats") == 0 || strcmp(a, "--hot-keys") == 0 ||
+                   strcmp(a, "--hll-error") == 0 || strcmp(a, "--cm-epsilon") == 0 ||
+                   strcmp(a, "--cm-delta") == 0) {
+            i++;
+        }
+    }
+
+    if (opt->approx && (opt->hll_error <= 0 || opt->hll_error >= 1 || opt->cm_epsilon <= 0 ||
+                        opt->cm_epsilon >= 1 || opt->cm_delta <= 0 || opt->cm_delta >= 1)) {
+        if (verbose) fprintf(stderr, "--hll-error, --cm-epsilon and --cm-delta must be in (0, 1)\n");
+        return -1;
+    }
+
+    if (opt->incremental && (opt->approx || opt->memory_budget > 0)) {
+        if (verbose) fprintf(stderr, "--incremental cannot be combined with --approx or --memory-budget\n");
+        return -1;
+    }
+
+    if (opt->binary && (opt->approx || opt->memory_budget > 0)) {
+        if (verbose) fprintf(stderr, "--format binary cannot be combined with --approx or --memory-budget\n");
+        return -1;
+    }
+
+    if (!any_source) {
+        for (int i = 0; i < 9; i++) {
+            driver_add_file(opt, driver_default_files[i][0], driver_default_files[i][1]);
+        }
+    }
+    return 0;
+}
+
+static inline void driver_free(DriverOptions* opt) {
+    for (int i = 0; i < opt->file_count; i++) {
+        free(opt->files[i].input);
+        free(opt->files[i].output);
+    }
+    free(opt->files);
+    opt->files = NULL;
+    opt->file_count = opt->file_capacity = 0;
+}
+
+// 实际同时处理的文件数：auto_jobs 为按核数估计的并发度，不超过文件数
+static inline int driver_jobs(const DriverOptions* opt, int auto_jobs) {
+    int jobs = opt->jobs > 0 ? opt->jobs : auto_jobs;
+    if (jobs > opt->file_count) jobs = opt->file_count;
+    return jobs > 0 ? jobs : 1;
+}
+
+#endif
@@ -0,0 +1,1097 @@
+#ifndef ENGINE_MPI_H
+#define ENGINE_MPI_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <mpi.h>
+
+#include "driver.h"
+#include "entry_set.h"
+#include "hash_table.h"
+#include "hot_keys.h"
+#include "mmap_reader.h"
+#include "radix_sort.h"
+#include "top_k.h"
+#include "sketch.h"
+#include "checkpoint.h"
+#include "result_file.h"
+#include "stats.h"
+#ifdef _OPENMP
+#include <omp.h>
+#include "omp_tables.h"
+#endif
+
+#define BUCKET_SIZE (1 << 20)
+
+// 所有集合通信都在参数 comm 上进行：同时处理多个文件时，每个文件由 comm 中的一组进程负责。
+// 混合模式（MPI+OpenMP）下每个进程用多个线程解析、计数和排序，MPI 调用只出现在并行区之外
+// （MPI_THREAD_FUNNELED）。
+
+// 每个进程的计数表，在各文件之间复用。单线程时只有一张表；多线程时为 omp_tables.h 的
+// 各分片，分片之间的键互不相交。下游统一按 shards[0..shard_count) 处理
+typedef struct {
+    int threads;
+    HashMap* table;
+    HashMap** shards;
+    int shard_count;
+    int hot_limit;          // 单线程时本进程检测的热点键个数上限，见 hot_keys.h
+    HotKeys hot;
+#ifdef _OPENMP
+    OmpTables omp;
+#endif
+} MpiTables;
+
+static inline void mpi_tables_init(MpiTables* t, int threads, unsigned int table_size, int hot_limit) {
+    t->threads = threads;
+    t->table = NULL;
+    t->shards = NULL;
+    t->shard_count = 0;
+    t->hot_limit = hot_limit;
+#ifdef _OPENMP
+    if (threads > 1) {
+        omp_tables_init(&t->omp, threads, hot_limit);
+        return;
+    }
+#endif
+    t->table = create_hashmap(table_size ? table_size : BUCKET_SIZE);
+    t->shards = &t->table;
+    t->shard_count = 1;
+}
+
+static inline void mpi_tables_free(MpiTables* t) {
+#ifdef _OPENMP
+    if (t->threads > 1) {
+        omp_tables_free(&t->omp);
+        return;
+    }
+#endif
+    destroy_hashmap(t->table);
+}
+
+static inline void mpi_tables_clear(MpiTables* t) {
+    for (int p = 0; p < t->shard_count; ++p) hashmap_clear(t->shards[p]);
+}
+
+// 条目按 (次数降序, 键升序) 或按键比较；两个条目可以来自不同的集合
+static inline int cmp_key(const EntrySet* a, int i, const EntrySet* b, int j) {
+    return strcmp(entryset_key(a, i), entryset_key(b, j));
+}
+
+static inline int cmp_value(const EntrySet* a, int i, const EntrySet* b, int j) {
+    int va = a->entries[i].count, vb = b->entries[j].count;
+    if (va != vb) {
+        return va > vb ? -1 : 1;
+    }
+    return strcmp(entryset_key(a, i), entryset_key(b, j));
+}
+
+typedef int (*EntryCmp)(const EntrySet*, int, const EntrySet*, int);
+
+// 归并同一集合中相邻的两个有序段 [left, mid] 与 [mid + 1, right]，只移动条目，键不动
+static inline void merge_entries(EntrySet* set, int left, int mid, int right, EntryCmp cmp) {
+    int n1 = mid - left + 1;
+    int n2 = right - mid;
+    KeyEntry* arr = set->entries;
+
+    KeyEntry* L = (KeyEntry*)malloc(n1 * sizeof(KeyEntry));
+    KeyEntry* R = (KeyEntry*)malloc(n2 * sizeof(KeyEntry));
+    memcpy(L, arr + left, n1 * sizeof(KeyEntry));
+    memcpy(R, arr + mid + 1, n2 * sizeof(KeyEntry));
+
+    // 比较时借用两个只含一段条目的视图，共享同一个字符串区
+    EntrySet lv = *set, rv = *set;
+    lv.entries = L;
+    rv.entries = R;
+
+    int i = 0, j = 0, k = left;
+    while (i < n1 && j < n2) {
+        if (cmp(&lv, i, &rv, j) <= 0) {
+            arr[k++] = L[i++];
+        } else {
+            arr[k++] = R[j++];
+        }
+    }
+
+    while (i < n1) arr[k++] = L[i++];
+    while (j < n2) arr[k++] = R[j++];
+
+    free(L);
+    free(R);
+}
+
+// 把 src 的第 k 个条目追加到按键有序的 out 末尾，与最后一个键相同时累加次数
+static inline void merge_push(EntrySet* out, const EntrySet* src, int k) {
+    const KeyEntry* e = &src->entries[k];
+    if (out->size > 0 && cmp_key(out, out->size - 1, src, k) == 0) {
+        out->entries[out->size - 1].count += e->count;
+    } else {
+        entryset_push(out, entryset_key(src, k), e->len, e->count, e->hash);
+    }
+}
+
+// 把有序集合 b 整个归并进 out，a 中从 *i 起不大于 b 最后一个键的条目一并归并，
+// *i 前进到 a 中第一个未归并的条目。b 可以是另一个有序序列的一段，依次对各段调用
+// 即可边接收边归并（a 的键互不相同，剩下的条目都大于 b 的最后一个键）
+static inline void merge_sorted_step(const EntrySet* a, int* i, const EntrySet* b, EntrySet* out) {
+    int j = 0;
+    while (j < b->size) {
+        if (*i < a->size && cmp_key(a, *i, b, j) <= 0) merge_push(out, a, (*i)++);
+        else merge_push(out, b, j++);
+    }
+}
+
+// displs[0..runs] 划分出的若干有序段，自底向上两两归并为一个有序序列
+static inline void merge_runs(EntrySet* set, const int* displs, int runs, EntryCmp cmp) {
+    for (int width = 1; width < runs; width *= 2) {
+        for (int i = 0; i + width < runs; i += 2 * width) {
+            int hi = i + 2 * width < runs ? i + 2 * width : runs;
+            int left = displs[i];
+            int mid = displs[i + width] - 1;
+            int right = displs[hi] - 1;
+            if (left <= mid && mid < right) {
+                merge_entries(set, left, mid, right, cmp);
+            }
+        }
+    }
+}
+
+// 集合须已按 (次数降序, 键升序) 排好；binary 时写成二进制结果，否则写文本，都由 result_file.h 完成
+static inline void write_entries(const char* output_file, const EntrySet* set, bool binary) {
+    SortEntry* entries = (SortEntry*)malloc(sizeof(SortEntry) * (set->size > 0 ? set->size : 1));
+    for (int i = 0; i < set->size; ++i) {
+        entries[i].key = entryset_key(set, i);
+        entries[i].count = set->entries[i].count;
+    }
+    int written = binary ? result_write_binary(output_file, entries, set->size)
+                         : result_write_entries_text(output_file, entries, set->size);
+    if (written != 0) {
+        fprintf(stderr, "Cannot write output file: %s\n", output_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    free(entries);
+}
+
+// 树形归并中一条消息携带的条目数。发送方编码下一段时上一段仍在发送，
+// 接收方归并这一段时下一段已在接收，两端各用两块轮换的缓冲区
+#define TREE_CHUNK_ENTRIES 16384
+#define TREE_CHUNK_BYTES (TREE_CHUNK_ENTRIES * FRONT_ENTRY_MAX)
+
+// 把按键有序的 set 分段前缀压缩后发给 dst，以一条空消息结束。返回发送的字节数
+static inline size_t send_sorted_chunks(MPI_Comm comm, const EntrySet* set, int dst) {
+    char* bufs[2] = {(char*)malloc(TREE_CHUNK_BYTES), (char*)malloc(TREE_CHUNK_BYTES)};
+    MPI_Request reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    size_t sent = 0;
+    int cur = 0;
+    for (int begin = 0; begin < set->size; begin += TREE_CHUNK_ENTRIES) {
+        int end = set->size - begin > TREE_CHUNK_ENTRIES ? begin + TREE_CHUNK_ENTRIES : set->size;
+        MPI_Wait(&reqs[cur], MPI_STATUS_IGNORE);
+        size_t n = entryset_encode_front(set, begin, end, bufs[cur]);
+        MPI_Isend(bufs[cur], (int)n, MPI_BYTE, dst, 0, comm, &reqs[cur]);
+        sent += n;
+        cur ^= 1;
+    }
+    MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+    MPI_Send(NULL, 0, MPI_BYTE, dst, 0, comm);
+    free(bufs[0]);
+    free(bufs[1]);
+    return sent;
+}
+
+// 接收 src 用 send_sorted_chunks 发来的有序序列，逐段与 local 归并，结果写入 out。
+// 返回接收的字节数。接收缓冲区末尾多留 FRONT_KEY_COPY 字节，见 entryset_decode_front
+static inline size_t merge_sorted_chunks(MPI_Comm comm, const EntrySet* local, int src, EntrySet* out) {
+    char* bufs[2] = {(char*)calloc(1, TREE_CHUNK_BYTES + FRONT_KEY_COPY),
+                     (char*)calloc(1, TREE_CHUNK_BYTES + FRONT_KEY_COPY)};
+    EntrySet chunk;
+    entryset_init(&chunk);
+    entryset_reserve(out, local->size, local->bytes);
+    size_t received = 0;
+    int i = 0, cur = 0;
+    MPI_Request req;
+    MPI_Irecv(bufs[cur], TREE_CHUNK_BYTES, MPI_BYTE, src, 0, comm, &req);
+    for (;;) {
+        MPI_Status status;
+        int n;
+        MPI_Wait(&req, &status);
+        MPI_Get_count(&status, MPI_BYTE, &n);
+        if (n == 0) break;
+        MPI_Irecv(bufs[cur ^ 1], TREE_CHUNK_BYTES, MPI_BYTE, src, 0, comm, &req);
+        chunk.size = 0;
+        chunk.bytes = 0;
+        entryset_decode_front(&chunk, bufs[cur], (size_t)n);
+        merge_sorted_step(local, &i, &chunk, out);
+        received += (size_t)n;
+        cur ^= 1;
+    }
+    while (i < local->size) merge_push(out, local, i++);
+    entryset_free(&chunk);
+    free(bufs[0]);
+    free(bufs[1]);
+    return received;
+}
+
+// MPI 的个数和位移都是 int。条目数和键的字节数先按 64 位计算，超出 int 时给出说明后中止，
+// 不让回绕后的负数或错误的位移传给集合通信（单个进程的键超过 2GB 时就会发生）
+static inline int mpi_int_count(long long v, const char* what) {
+    if (v > INT_MAX) {
+        fprintf(stderr, "%s (%lld) exceeds the MPI count limit %d; use more ranks\n", what, v, INT_MAX);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return (int)v;
+}
+
+// displs[r + 1] = displs[r] + counts[r]（r < n），按 64 位累加并检查
+static inline void mpi_prefix_displs(const int* counts, int* displs, int n, const char* what) {
+    long long sum = 0;
+    displs[0] = 0;
+    for (int r = 0; r < n; ++r) {
+        sum += counts[r];
+        displs[r + 1] = mpi_int_count(sum, what);
+    }
+}
+
+static inline MPI_Datatype key_entry_type() {
+    MPI_Datatype type;
+    MPI_Type_contiguous(sizeof(KeyEntry), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+// 紧凑集合 send 中第 r 段条目 [send_displs[r], send_displs[r+1]) 发给进程 r（MPI_Alltoallv）。
+// 条目和对应的键字节分两次交换，键按实际长度发送；收到的各段依次放入 recv，
+// recv_displs 返回各段的条目起点
+static inline void exchange_entries(MPI_Comm comm, const EntrySet* send, const int* send_displs,
+                                    EntrySet* recv, int* recv_displs) {
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    int* send_counts = (int*)malloc(size * sizeof(int));
+    int* send_bytes = (int*)malloc(size * sizeof(int));
+    int* send_byte_displs = (int*)malloc(size * sizeof(int));
+    for (int r = 0; r < size; ++r) {
+        size_t begin;
+        send_counts[r] = send_displs[r + 1] - send_displs[r];
+        size_t bytes = entryset_span(send, send_displs[r], send_displs[r + 1], &begin);
+        send_bytes[r] = mpi_int_count((long long)bytes, "Shuffled key bytes");
+        send_byte_displs[r] = mpi_int_count((long long)begin, "Shuffled key bytes");
+    }
+
+    int* recv_counts = (int*)malloc(size * sizeof(int));
+    int* recv_bytes = (int*)malloc(size * sizeof(int));
+    int* recv_byte_displs = (int*)calloc(size + 1, sizeof(int));
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+    MPI_Alltoall(send_bytes, 1, MPI_INT, recv_bytes, 1, MPI_INT, comm);
+    mpi_prefix_displs(recv_counts, recv_displs, size, "Shuffled entries");
+    mpi_prefix_displs(recv_bytes, recv_byte_displs, size, "Shuffled key bytes");
+
+    recv->size = 0;
+    recv->bytes = 0;
+    entryset_reserve(recv, recv_displs[size], recv_byte_displs[size]);
+    MPI_Datatype entry_type = key_entry_type();
+    MPI_Alltoallv(send->entries, send_counts, send_displs, entry_type,
+                  recv->entries, recv_counts, recv_displs, entry_type, comm);
+    MPI_Alltoallv(send->strings, send_bytes, send_byte_displs, MPI_CHAR,
+                  recv->strings, recv_bytes, recv_byte_displs, MPI_CHAR, comm);
+    MPI_Type_free(&entry_type);
+    recv->size = recv_displs[size];
+    recv->bytes = recv_byte_displs[size];
+    entryset_rebase(recv, recv_displs, recv_byte_displs, size);
+    // 字节统计含发给自己的一段
+    STATS_ADD(STAT_BYTES_SENT, (size_t)send_displs[size] * sizeof(KeyEntry) + send->bytes);
+    STATS_ADD(STAT_BYTES_RECV, (size_t)recv->size * sizeof(KeyEntry) + recv->bytes);
+
+    free(send_counts);
+    free(send_bytes);
+    free(send_byte_displs);
+    free(recv_counts);
+    free(recv_bytes);
+    free(recv_byte_displs);
+}
+
+// 按键哈希的高位把局部计数分发给各进程：进程 r 只收到 hash_shard(h, size) == r 的键，
+// 各进程拥有互不相交的键集合并在本地聚合，任何进程都只持有约 1/P 的不同键。
+// 本进程负责的聚合结果写入 owned，各分片被清空。
+// 有多个分片时收到的键再按哈希的下一段高位分给各线程，线程 p 只写 shards[p]。
+static inline void shuffle_by_hash(MPI_Comm comm, HashMap* const* shards, int n, EntrySet* owned) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // 先统计每个目标进程的条目数和键字节数，再把条目和键直接放到各自的位置上，
+    // 发送集合按目标进程分段且是紧凑的
+    int* displs = (int*)calloc(size + 1, sizeof(int));
+    size_t* byte_displs = (size_t*)calloc(size + 1, sizeof(size_t));
+    for (int p = 0; p < n; ++p) {
+        const HashMap* table = shards[p];
+        for (unsigned int i = 0; i < table->capacity; ++i) {
+            const Slot* s = &table->slots[i];
+            if (!s->key) continue;
+            int r = hash_shard(s->hash, size);
+            displs[r + 1]++;
+            byte_displs[r + 1] += strlen(s->key) + 1;
+        }
+    }
+    for (int r = 0; r < size; ++r) {
+        displs[r + 1] += displs[r];
+        byte_displs[r + 1] += byte_displs[r];
+    }
+
+    EntrySet send;
+    entryset_init(&send);
+    entryset_reserve(&send, displs[size], byte_displs[size]);
+    int* pos = (int*)malloc(size * sizeof(int));
+    memcpy(pos, displs, size * sizeof(int));
+    for (int p = 0; p < n; ++p) {
+        const HashMap* table = shards[p];
+        for (unsigned int i = 0; i < table->capacity; ++i) {
+            const Slot* s = &table->slots[i];
+            if (!s->key) continue;
+            int r = hash_shard(s->hash, size);
+            size_t len = strlen(s->key);
+            KeyEntry* e = &send.entries[pos[r]++];
+            e->offset = (unsigned int)byte_displs[r];
+            e->len = (unsigned int)len;
+            e->count = s->count;
+            e->hash = s->hash;
+            memcpy(send.strings + byte_displs[r], s->key, len + 1);
+            byte_displs[r] += len + 1;
+        }
+    }
+    send.size = displs[size];
+    send.bytes = byte_displs[size];
+    free(pos);
+    free(byte_displs);
+    // 本地计数已全部进入发送集合，表清空后用来聚合收到的键
+    for (int p = 0; p < n; ++p) hashmap_clear(shards[p]);
+
+    EntrySet recv;
+    entryset_init(&recv);
+    int* recv_displs = (int*)malloc((size + 1) * sizeof(int));
+    exchange_entries(comm, &send, displs, &recv, recv_displs);
+    entryset_free(&send);
+    free(displs);
+    free(recv_displs);
+
+    // 哈希随条目一起发送，接收方不必重新计算。本进程收到的键满足 hash_shard(h, size) == rank，
+    // 把这段哈希区间再均分 n 份：hash_shard(h, size * n) - rank * n 即为所属分片
+    if (n == 1) {
+        for (int i = 0; i < recv.size; ++i) {
+            const KeyEntry* e = &recv.entries[i];
+            hashmap_add_hashed(shards[0], entryset_key(&recv, i), e->len, e->hash, e->count);
+        }
+    } else {
+        int* starts = (int*)calloc(n + 1, sizeof(int));
+        int* order = (int*)malloc((recv.size > 0 ? recv.size : 1) * sizeof(int));
+        for (int i = 0; i < recv.size; ++i) {
+            starts[hash_shard(recv.entries[i].hash, size * n) - rank * n + 1]++;
+        }
+        for (int p = 0; p < n; ++p) starts[p + 1] += starts[p];
+        int* fill = (int*)malloc(n * sizeof(int));
+        memcpy(fill, starts, n * sizeof(int));
+        for (int i = 0; i < recv.size; ++i) {
+            order[fill[hash_shard(recv.entries[i].hash, size * n) - rank * n]++] = i;
+        }
+        free(fill);
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(n) schedule(static, 1)
+#endif
+        for (int p = 0; p < n; ++p) {
+            for (int k = starts[p]; k < starts[p + 1]; ++k) {
+                const KeyEntry* e = &recv.entries[order[k]];
+                hashmap_add_hashed(shards[p], entryset_key(&recv, order[k]), e->len, e->hash, e->count);
+            }
+        }
+        free(starts);
+        free(order);
+    }
+    entryset_free(&recv);
+
+    entryset_from_tables(owned, shards, n);
+    for (int p = 0; p < n; ++p) hashmap_clear(shards[p]);
+}
+
+// 在有序集合中找第一个大于 splitter 的位置
+static inline int upper_bound(const EntrySet* set, const EntrySet* samples, int splitter) {
+    int lo = 0, hi = set->size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cmp_value(set, mid, samples, splitter) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// 按 (次数降序, 键升序) 做分布式样本排序：各进程本地排序后取 P-1 个等距样本，
+// 全体样本排序后选出 P-1 个分割点，按分割点交换数据桶，再把收到的有序段归并。
+// 结束后 rank r 持有全局有序序列的第 r 段。shuffle 之后各键只在一个进程上，
+// cmp_value 构成严格全序，与分割点相等的条目一律归入较低的桶。
+static inline void sample_sort(MPI_Comm comm, EntrySet* set) {
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    entryset_sort(set, true);
+    if (size == 1) return;
+    int n = set->size;
+
+    // 等距取样，条目不足 P-1 个时有多少取多少
+    int sample_count = n < size - 1 ? n : size - 1;
+    EntrySet samples;
+    entryset_init(&samples);
+    for (int i = 0; i < sample_count; ++i) {
+        int k = (int)((long long)(i + 1) * n / (sample_count + 1));
+        const KeyEntry* e = &set->entries[k];
+        entryset_push(&samples, entryset_key(set, k), e->len, e->count, e->hash);
+    }
+
+    int* sample_counts = (int*)malloc(size * sizeof(int));
+    int* sample_displs = (int*)calloc(size + 1, sizeof(int));
+    int* sample_bytes = (int*)malloc(size * sizeof(int));
+    int* sample_byte_displs = (int*)calloc(size + 1, sizeof(int));
+    int local_bytes = mpi_int_count((long long)samples.bytes, "Sample key bytes");
+    MPI_Allgather(&sample_count, 1, MPI_INT, sample_counts, 1, MPI_INT, comm);
+    MPI_Allgather(&local_bytes, 1, MPI_INT, sample_bytes, 1, MPI_INT, comm);
+    mpi_prefix_displs(sample_counts, sample_displs, size, "Sample entries");
+    mpi_prefix_displs(sample_bytes, sample_byte_displs, size, "Sample key bytes");
+
+    int total_samples = sample_displs[size];
+    EntrySet all_samples;
+    entryset_init(&all_samples);
+    entryset_reserve(&all_samples, total_samples, sample_byte_displs[size]);
+    MPI_Datatype entry_type = key_entry_type();
+    MPI_Allgatherv(samples.entries, sample_count, entry_type,
+                   all_samples.entries, sample_counts, sample_displs, entry_type, comm);
+    MPI_Allgatherv(samples.strings, local_bytes, MPI_CHAR,
+                   all_samples.strings, sample_bytes, sample_byte_displs, MPI_CHAR, comm);
+    MPI_Type_free(&entry_type);
+    all_samples.size = total_samples;
+    all_samples.bytes = sample_byte_displs[size];
+    entryset_rebase(&all_samples, sample_displs, sample_byte_displs, size);
+    merge_runs(&all_samples, sample_displs, size, cmp_value);
+    entryset_free(&samples);
+    free(sample_counts);
+    free(sample_displs);
+    free(sample_bytes);
+    free(sample_byte_displs);
+
+    // 分割点把本地有序集合切成 P 个桶；没有样本时全部留在 rank 0 的桶里
+    int* send_displs = (int*)calloc(size + 1, sizeof(int));
+    for (int r = 0; r < size - 1; ++r) {
+        int bound = n;
+        if (total_samples > 0) {
+            int splitter = (int)((long long)(r + 1) * total_samples / size);
+            bound = upper_bound(set, &all_samples, splitter);
+        }
+        send_displs[r + 1] = bound > send_displs[r] ? bound : send_displs[r];
+    }
+    send_displs[size] = n;
+    entryset_free(&all_samples);
+
+    EntrySet bucket;
+    entryset_init(&bucket);
+    int* recv_displs = (int*)malloc((size + 1) * sizeof(int));
+    exchange_entries(comm, set, send_displs, &bucket, recv_displs);
+    merge_runs(&bucket, recv_displs, size, cmp_value);
+
+    free(send_displs);
+    free(recv_displs);
+    entryset_free(set);
+    *set = bucket;
+}
+
+// 样本排序之后按 rank 顺序拼接即为全局有序结果。各进程把自己那一段格式化到本地缓冲区，
+// MPI_Exscan 求出字节偏移后用 MPI_File_write_at_all 一起写出；首行的总数由 rank 0 写在最前面。
+static inline void write_entries_collective(MPI_Comm comm, const EntrySet* set, const char* output_file) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    int count = set->size;
+    int total = 0;
+    MPI_Allreduce(&count, &total, 1, MPI_INT, MPI_SUM, comm);
+
+    char header[16];
+    int header_len = sprintf(header, "%d\n", total);
+
+    // 字符串区中每个键后的 '\0' 正好对应空格，每行另加最多 10 位数字和换行
+    size_t cap = set->bytes + (size_t)count * 11 + (rank == 0 ? header_len : 0);
+    char* buf = (char*)malloc(cap > 0 ? cap : 1);
+    long long len = 0;
+    if (rank == 0) {
+        memcpy(buf, header, header_len);
+        len = header_len;
+    }
+    for (int i = 0; i < count; ++i) {
+        const KeyEntry* e = &set->entries[i];
+        memcpy(buf + len, entryset_key(set, i), e->len);
+        len += e->len;
+        buf[len++] = ' ';
+        len += format_uint(buf + len, (unsigned int)e->count);
+        buf[len++] = '\n';
+    }
+
+    long long offset = 0;
+    MPI_Exscan(&len, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0) offset = 0;
+
+    MPI_File fh;
+    if (MPI_File_open(comm, output_file, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) fprintf(stderr, "Cannot open output file: %s\n", output_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_set_size(fh, 0);
+
+    // write_at_all 的计数是 int，超大缓冲区分块写；集合调用次数要在各进程间一致
+    const long long chunk = 1 << 30;
+    long long rounds = (len + chunk - 1) / chunk;
+    long long max_rounds = 0;
+    MPI_Allreduce(&rounds, &max_rounds, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    for (long long r = 0; r < max_rounds; ++r) {
+        long long done = r * chunk < len ? r * chunk : len;
+        long long piece = len - done < chunk ? len - done : chunk;
+        MPI_File_write_at_all(fh, offset + done, buf + done, (int)piece, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+    MPI_File_close(&fh);
+    free(buf);
+}
+
+// 从集合中选出前 k 个，按 (次数降序, 键升序) 追加到 out
+static inline void select_top_k(const EntrySet* set, int k, EntrySet* out) {
+    TopK heap;
+    topk_init(&heap, k);
+    for (int i = 0; i < set->size; ++i) {
+        topk_offer(&heap, entryset_key(set, i), set->entries[i].count);
+    }
+    int count = topk_finish(&heap);
+    for (int i = 0; i < count; ++i) {
+        const char* key = heap.data[i].key;
+        size_t len = strlen(key);
+        entryset_push(out, key, len, heap.data[i].count, hash_string(key, len));
+    }
+    topk_free(&heap);
+}
+
+// 把各进程的紧凑集合 local 按 rank 顺序收集到 rank 0 的 all 中（其他进程的 all 保持为空）
+static inline void gather_entries(MPI_Comm comm, const EntrySet* local, EntrySet* all) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int local_bytes = mpi_int_count((long long)local->bytes, "Gathered key bytes");
+
+    int* counts = NULL;
+    int* displs = NULL;
+    int* bytes = NULL;
+    int* byte_displs = NULL;
+    if (rank == 0) {
+        counts = (int*)malloc(size * sizeof(int));
+        displs = (int*)calloc(size + 1, sizeof(int));
+        bytes = (int*)malloc(size * sizeof(int));
+        byte_displs = (int*)calloc(size + 1, sizeof(int));
+    }
+    MPI_Gather(&local->size, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+    MPI_Gather(&local_bytes, 1, MPI_INT, bytes, 1, MPI_INT, 0, comm);
+    if (rank == 0) {
+        mpi_prefix_displs(counts, displs, size, "Gathered entries");
+        mpi_prefix_displs(bytes, byte_displs, size, "Gathered key bytes");
+        entryset_reserve(all, displs[size], byte_displs[size]);
+    }
+    MPI_Datatype entry_type = key_entry_type();
+    MPI_Gatherv(local->entries, local->size, entry_type,
+                all->entries, counts, displs, entry_type, 0, comm);
+    MPI_Gatherv(local->strings, local_bytes, MPI_CHAR,
+                all->strings, bytes, byte_displs, MPI_CHAR, 0, comm);
+    MPI_Type_free(&entry_type);
+    STATS_ADD(STAT_BYTES_SENT, (size_t)local->size * sizeof(KeyEntry) + local->bytes);
+
+    if (rank == 0) {
+        all->size = displs[size];
+        all->bytes = byte_displs[size];
+        STATS_ADD(STAT_BYTES_RECV, (size_t)all->size * sizeof(KeyEntry) + all->bytes);
+        entryset_rebase(all, displs, byte_displs, size);
+        free(counts);
+        free(displs);
+        free(bytes);
+        free(byte_displs);
+    }
+}
+
+// shuffle 之后各进程的键互不相交、计数已是全局值，因此各自选出前 k 个即可，
+// rank 0 只需收集 P * k 个候选再选一次，通信量与不同键的总数无关
+static inline void gather_top_k(MPI_Comm comm, const EntrySet* owned, int k, const char* output_file,
+                                bool binary) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    EntrySet local_top;
+    entryset_init(&local_top);
+    select_top_k(owned, k, &local_top);
+    EntrySet candidates;
+    entryset_init(&candidates);
+    gather_entries(comm, &local_top, &candidates);
+    entryset_free(&local_top);
+
+    if (rank == 0) {
+        EntrySet top;
+        entryset_init(&top);
+        select_top_k(&candidates, k, &top);
+        write_entries(output_file, &top, binary);
+        entryset_free(&top);
+    }
+    entryset_free(&candidates);
+}
+
+// 把文件中 [lo, hi) 的字节均分给 size 个进程（lo、hi 须为行首），rank 的区间写入 [*start, *end)。
+// 区间两端都对齐到行首，跨界的行归前一个进程
+static inline void rank_byte_range(const MappedFile* file, size_t lo, size_t hi, int rank, int size,
+                                   size_t* start, size_t* end) {
+    size_t chunk_size = (hi - lo) / size;
+    size_t remainder = (hi - lo) % size;
+    size_t first = lo + rank * chunk_size + (rank < (int)remainder ? rank : remainder);
+    size_t last = first + chunk_size + (rank < (int)remainder ? 1 : 0);
+    *start = line_start_after(file, first);
+    *end = last >= hi ? hi : line_start_after(file, last);
+}
+
+// 近似模式：各进程用 n 份 Sketch（每线程一份）统计自己的区间。寄存器与 Count-Min 是定长数组，
+// 分别以 MPI_MAX / MPI_SUM 归约到 rank 0；各进程的候选键按定长记录收集到 rank 0 去重，
+// 再用全局的 Count-Min 估计次数、选出高频键写出
+static inline void sketch_mpi(MPI_Comm comm, Sketch* sketches, int n, const SketchParams* p,
+                              const char* input_file, const char* output_file) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    MappedFile file;
+    if (map_file(input_file, &file) != 0) {
+        fprintf(stderr, "Cannot open input file: %s\n", input_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    size_t start, end;
+    rank_byte_range(&file, 0, file.size, rank, size, &start, &end);
+    HashMap* local = create_hashmap(sketches[0].capacity * 2 * n);
+    sketch_count_range(sketches, n, &file, start, end, local);
+    unmap_file(&file);
+
+    Sketch* s = &sketches[0];
+    int regs = 1 << s->precision;
+    int cells = s->width * s->depth;
+    if (rank == 0) {
+        MPI_Reduce(MPI_IN_PLACE, s->registers, regs, MPI_UNSIGNED_CHAR, MPI_MAX, 0, comm);
+        MPI_Reduce(MPI_IN_PLACE, s->cm, cells, MPI_UNSIGNED, MPI_SUM, 0, comm);
+        MPI_Reduce(MPI_IN_PLACE, &s->lines, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(s->registers, NULL, regs, MPI_UNSIGNED_CHAR, MPI_MAX, 0, comm);
+        MPI_Reduce(s->cm, NULL, cells, MPI_UNSIGNED, MPI_SUM, 0, comm);
+        MPI_Reduce(&s->lines, NULL, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, comm);
+    }
+    STATS_ADD(STAT_BYTES_SENT, rank == 0 ? 0 : (size_t)regs + (size_t)cells * sizeof(unsigned int));
+
+    // 候选键按 MAX_KEY_LEN 字节的定长记录发送
+    int count = (int)local->size;
+    char* records = (char*)calloc(count > 0 ? count : 1, MAX_KEY_LEN);
+    int k = 0;
+    for (unsigned int i = 0; i < local->capacity; i++) {
+        if (local->slots[i].key) strcpy(records + (size_t)k++ * MAX_KEY_LEN, local->slots[i].key);
+    }
+    destroy_hashmap(local);
+
+    MPI_Datatype record_type;
+    MPI_Type_contiguous(MAX_KEY_LEN, MPI_CHAR, &record_type);
+    MPI_Type_commit(&record_type);
+    int* counts = NULL;
+    int* displs = NULL;
+    char* all = NULL;
+    if (rank == 0) {
+        counts = (int*)malloc(size * sizeof(int));
+        displs = (int*)calloc(size + 1, sizeof(int));
+    }
+    MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+    if (rank == 0) {
+        for (int r = 0; r < size; r++) displs[r + 1] = displs[r] + counts[r];
+        all = (char*)malloc((size_t)(displs[size] > 0 ? displs[size] : 1) * MAX_KEY_LEN);
+    }
+    MPI_Gatherv(records, count, record_type, all, counts, displs, record_type, 0, comm);
+    MPI_Type_free(&record_type);
+    STATS_ADD(STAT_BYTES_SENT, (size_t)count * MAX_KEY_LEN);
+    free(records);
+
+    if (rank == 0) {
+        HashMap* candidates = create_hashmap(displs[size] * 2);
+        for (int i = 0; i < displs[size]; i++) {
+            const char* key = all + (size_t)i * MAX_KEY_LEN;
+            sketch_add_candidate(candidates, key, strlen(key));
+        }
+        TopK top;
+        sketch_select(s, candidates, p->heavy, &top);
+        sketch_write(output_file, sketch_distinct(s), &top);
+        topk_free(&top);
+        destroy_hashmap(candidates);
+        free(counts);
+        free(displs);
+        free(all);
+    }
+    for (int t = 0; t < n; t++) sketch_clear(&sketches[t]);
+}
+
+// tables 由 run_mpi 创建并在各文件之间复用，每次处理完清空但保留内存；
+// table_size 为多线程时全部分片的总槽位数，0 表示默认。
+// incremental 时由 rank 0 读取保存的状态，各进程只划分其后新增的完整行；状态要由一个进程
+// 完整写出，因此总是走树形归并，top-k 在 rank 0 上从归并结果中选出。
+// binary 时输出二进制结果：键序索引要看到全部条目，shuffle 之后也收集到 rank 0 再写。
+// next_input 为本组接下来要处理的文件（没有时为 NULL），计数完成后即开始预取
+static inline void group_by_mpi(MPI_Comm comm, MpiTables* tables, const char* input_file,
+                                const char* output_file, bool shuffle, int top_k,
+                                unsigned int table_size, bool incremental, bool binary,
+                                const char* next_input) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // 各进程直接映射整个文件，只解析自己的字节区间，不再拷贝到本地缓冲区
+    STATS_TIMER(t_read);
+    MappedFile file;
+    if (map_file(input_file, &file) != 0) {
+        fprintf(stderr, "Cannot open input file: %s\n", input_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    size_t begin = 0, end_all = file.size;
+    MappedFile state = {NULL, 0};
+    bool saved = false;
+    CheckpointWriter writer;
+    char tail_key[MAX_KEY_LEN];
+    int tail_len = -1;
+    if (incremental) {
+        // 新状态的头部和末尾的半行都取自映射，在 rank 0 上趁映射还在时准备好
+        unsigned long long range[2] = {0, 0};
+        if (rank == 0) {
+            saved = checkpoint_open(output_file, input_file, &file, &state) == 0;
+            range[0] = saved ? checkpoint_header(&state)->offset : 0;
+            range[1] = checkpoint_line_end(&file, range[0]);
+            if (checkpoint_create(&writer, output_file, input_file, &file, range[1]) != 0) {
+                perror("Cannot write state file");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            KeySlice tail;
+            if (checkpoint_partial_line(&file, range[1], &tail)) {
+                memcpy(tail_key, tail.ptr, tail.len);
+                tail_len = (int)tail.len;
+            }
+        }
+        MPI_Bcast(range, 2, MPI_UNSIGNED_LONG_LONG, 0, comm);
+        begin = range[0];
+        end_all = range[1];
+        if (end_all > file.size) {
+            fprintf(stderr, "Input file changed while being read: %s\n", input_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    size_t start, end;
+    rank_byte_range(&file, begin, end_all, rank, size, &start, &end);
+    STATS_ELAPSED(STAT_READ, t_read);
+
+#ifdef _OPENMP
+    if (tables->threads > 1) {
+        // 进程内再把区间分给各线程，计数结果落在互不相交的分片里
+        double t_count;
+        tables->shard_count = omp_count_range(&tables->omp, &file, start, end, table_size, &t_count);
+        tables->shards = tables->omp.shards;
+    } else
+#endif
+    {
+        (void)table_size;
+        STATS_TIMER(t_count);
+        // 热点键先计入本进程的私有计数，读完再并入表，之后的归并/shuffle 与其他键相同
+        int hot_counts[HOT_KEYS_MAX] = {0};
+        hot_keys_detect(&tables->hot, &file, start, end, tables->hot_limit);
+        // 分块解析，下一块由内核在后台读入，解析过的页随即交还
+        MapStream stream;
+        LineReader reader;
+        LineBatch batch;
+        map_stream_init(&stream, &file, start, end);
+        while (map_stream_next(&stream, &reader)) {
+            while (line_reader_next_batch(&reader, &batch)) {
+                hot_keys_take(&tables->hot, hot_counts, &batch);
+                hashmap_add_batch(tables->table, &batch);
+            }
+        }
+        hot_keys_flush(&tables->hot, hot_counts, tables->table);
+        STATS_ELAPSED(STAT_COUNT, t_count);
+    }
+    unmap_file(&file);
+
+    // 归并和写出期间磁盘空闲，让内核先读入下一个文件中本进程那一份的开头
+    if (next_input) prefetch_file(next_input, rank, size);
+
+    // 保存的状态按分片规则并入 rank 0 的表，之后与普通的计数一样参与归并
+    if (saved && checkpoint_load(&state, tables->shards, tables->shard_count) != 0) {
+        fprintf(stderr, "State file of %s is truncated\n", output_file);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // top-k 依赖完整的全局计数，总是走 shuffle 聚合（增量模式除外，见上）
+    if (!incremental && (shuffle || top_k > 0)) {
+        EntrySet owned;
+        entryset_init(&owned);
+        STATS_TIMER(t_shuffle);
+        shuffle_by_hash(comm, tables->shards, tables->shard_count, &owned);
+        STATS_ELAPSED(STAT_MERGE, t_shuffle);
+        if (top_k > 0) {
+            STATS_TIMER(t_top);
+            gather_top_k(comm, &owned, top_k, output_file, binary);
+            STATS_ELAPSED(STAT_WRITE, t_top);
+        } else {
+            STATS_TIMER(t_sort);
+            sample_sort(comm, &owned);
+            STATS_ELAPSED(STAT_SORT, t_sort);
+            STATS_TIMER(t_write);
+            if (binary) {
+                // 各段按 rank 顺序拼接即为全局有序；样本排序只移动了条目，先整理成紧凑的再收集
+                EntrySet all;
+                entryset_init(&all);
+                entryset_compact(&owned);
+                gather_entries(comm, &owned, &all);
+                if (rank == 0) write_entries(output_file, &all, true);
+                entryset_free(&all);
+            } else {
+                write_entries_collective(comm, &owned, output_file);
+            }
+            STATS_ELAPSED(STAT_WRITE, t_write);
+        }
+        entryset_free(&owned);
+        return;
+    }
+
+    // 各分片的键互不相同，合在一起按键排好即可参与归并
+    STATS_TIMER(t_local_sort);
+    EntrySet local;
+    entryset_init(&local);
+    entryset_from_tables(&local, tables->shards, tables->shard_count);
+    mpi_tables_clear(tables);
+
+    entryset_sort(&local, false);
+    STATS_ELAPSED(STAT_SORT, t_local_sort);
+
+    // 每一轮把按键有序的序列分段前缀压缩后流水发送，接收方每收到一段就归并一段
+    STATS_TIMER(t_merge);
+    int step = 1;
+    while (step < size) {
+        if (rank % (2 * step) == 0) {
+            int src_rank = rank + step;
+            if (src_rank < size) {
+                EntrySet merged;
+                entryset_init(&merged);
+                size_t received = merge_sorted_chunks(comm, &local, src_rank, &merged);
+                STATS_ADD(STAT_BYTES_RECV, received);
+                entryset_free(&local);
+                local = merged;
+            }
+        } else {
+            size_t sent = send_sorted_chunks(comm, &local, rank - step);
+            STATS_ADD(STAT_BYTES_SENT, sent);
+            entryset_free(&local);
+            break;
+        }
+        step *= 2;
+    }
+    STATS_ELAPSED(STAT_MERGE, t_merge);
+
+    if (rank == 0 && incremental) {
+        // 归并结果按键有序，就是完整的新状态；末尾的半行写完状态后再计入
+        STATS_TIMER(t_state);
+        for (int i = 0; i < local.size; ++i) {
+            checkpoint_put(&writer, entryset_key(&local, i), local.entries[i].len, local.entries[i].count);
+        }
+        if (checkpoint_commit(&writer) != 0) {
+            perror("Cannot write state file");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (tail_len >= 0) {
+            tail_key[tail_len] = '\0';
+            int lo = 0, hi = local.size;
+            while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (strcmp(entryset_key(&local, mid), tail_key) < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            if (lo < local.size && strcmp(entryset_key(&local, lo), tail_key) == 0) {
+                local.entries[lo].count++;
+            } else {
+                entryset_push(&local, tail_key, tail_len, 1, hash_string(tail_key, tail_len));
+            }
+        }
+        STATS_ELAPSED(STAT_MERGE, t_state);
+    }
+
+    if (rank == 0) {
+        STATS_TIMER(t_sort);
+        entryset_sort(&local, true);
+        STATS_ELAPSED(STAT_SORT, t_sort);
+        STATS_TIMER(t_write);
+        if (top_k > 0) {
+            EntrySet top;
+            entryset_init(&top);
+            select_top_k(&local, top_k, &top);
+            write_entries(output_file, &top, binary);
+            entryset_free(&top);
+        } else {
+            write_entries(output_file, &local, binary);
+        }
+        STATS_ELAPSED(STAT_WRITE, t_write);
+    }
+
+    entryset_free(&local);
+}
+
+#if STATS_ENABLED
+// 各进程把自己所有线程的统计合计后收集到 rank 0，报告每个进程的合计、全体合计、
+// 进程间不均衡度，以及每个进程内线程间的不均衡度
+static inline void mpi_stats_report(MPI_Comm comm, FILE* f, const char* backend) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    StatTotals* items = (StatTotals*)calloc(STATS_MAX_THREADS, sizeof(StatTotals));
+    StatTotals mine;
+    double thread_imbalance[STAT_PHASES];
+    int n = stats_collect(items, &mine);
+    stats_imbalance(items, n, thread_imbalance);
+    free(items);
+
+    StatTotals* ranks = NULL;
+    double* imbalances = NULL;
+    if (rank == 0) {
+        ranks = (StatTotals*)malloc(sizeof(StatTotals) * size);
+        imbalances = (double*)malloc(sizeof(double) * STAT_PHASES * size);
+    }
+    MPI_Gather(&mine, sizeof(StatTotals), MPI_BYTE, ranks, sizeof(StatTotals), MPI_BYTE, 0, comm);
+    MPI_Gather(thread_imbalance, STAT_PHASES, MPI_DOUBLE, imbalances, STAT_PHASES, MPI_DOUBLE, 0, comm);
+    if (rank != 0) return;
+
+    StatTotals total;
+    memset(&total, 0, sizeof(total));
+    for (int r = 0; r < size; r++) stats_accumulate(&total, &ranks[r]);
+    double rank_imbalance[STAT_PHASES];
+    stats_imbalance(ranks, size, rank_imbalance);
+
+    if (f) {
+        fprintf(f, "{\"backend\": \"%s\", \"ranks\": [", backend);
+        for (int r = 0; r < size; r++) {
+            if (r) fprintf(f, ", ");
+            stats_write_totals(f, &ranks[r]);
+        }
+        fprintf(f, "], \"total\": ");
+        stats_write_totals(f, &total);
+        fprintf(f, ", \"imbalance\": ");
+        stats_write_imbalance(f, rank_imbalance);
+        fprintf(f, ", \"thread_imbalance\": [");
+        for (int r = 0; r < size; r++) {
+            if (r) fprintf(f, ", ");
+            stats_write_imbalance(f, imbalances + (size_t)r * STAT_PHASES);
+        }
+        fprintf(f, "]}\n");
+    }
+    free(ranks);
+    free(imbalances);
+}
+#endif
+
+// MPI 后端：默认全部进程一起处理每个文件。jobs > 1 时按 rank % jobs 把进程分成若干组，
+// 各组在自己的通信子上同时处理不同的文件（第 i 个文件归第 i % jobs 组）。
+// 混合后端（BACKEND_HYBRID）每个进程默认用全部可用的 OpenMP 线程，适合每个节点或插槽
+// 只起一个进程；MPI 后端默认单线程，--threads 可以为两者指定每个进程的线程数。
+static inline int run_mpi(const DriverOptions* opt) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = opt->threads > 0 ? opt->threads
+            : opt->backend == BACKEND_HYBRID ? omp_get_max_threads() : 1;
+    int provided;
+    MPI_Query_thread(&provided);
+    if (threads > 1 && provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) fprintf(stderr, "MPI does not provide MPI_THREAD_FUNNELED, using 1 thread per rank\n");
+        threads = 1;
+    }
+    omp_set_num_threads(threads);
+#else
+    if (opt->threads > 1 && rank == 0) {
+        fprintf(stderr, "Built without OpenMP, using 1 thread per rank\n");
+    }
+#endif
+
+    int jobs = driver_jobs(opt, 1);
+    if (jobs > size) jobs = size;
+    int color = rank % jobs;
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, color, rank, &comm);
+    int group_rank;
+    MPI_Comm_rank(comm, &group_rank);
+
+    MpiTables tables;
+    mpi_tables_init(&tables, threads, opt->table_size, opt->hot_keys);
+    SketchParams sketch = sketch_params(opt->hll_error, opt->cm_epsilon, opt->cm_delta, opt->top_k);
+    Sketch* sketches = NULL;
+    if (opt->approx) {
+        if (rank == 0) sketch_params_report(&sketch);
+        sketches = (Sketch*)malloc(sizeof(Sketch) * threads);
+        for (int t = 0; t < threads; t++) sketch_init(&sketches[t], &sketch);
+    }
+
+    double total_start = MPI_Wtime();
+    for (int i = color; i < opt->file_count; i += jobs) {
+        const FileJob* f = &opt->files[i];
+        if (group_rank == 0 && jobs == 1) {
+            printf("Processing file: %s -> %s\n", f->input, f->output);
+        }
+        double file_start = MPI_Wtime();
+        if (opt->approx) {
+            sketch_mpi(comm, sketches, threads, &sketch, f->input, f->output);
+        } else {
+            const char* next = i + jobs < opt->file_count ? opt->files[i + jobs].input : NULL;
+            group_by_mpi(comm, &tables, f->input, f->output, opt->shuffle, opt->top_k, opt->table_size,
+                         opt->incremental, opt->binary, next);
+        }
+        double file_end = MPI_Wtime();
+        if (group_rank == 0) {
+            // 多组同时输出时一次写出两行，避免与其他组交错
+            if (jobs > 1) {
+                printf("Processing file: %s -> %s\nFile processed in %.3f seconds\n",
+                       f->input, f->output, file_end - file_start);
+            } else {
+                printf("File processed in %.3f seconds\n", file_end - file_start);
+            }
+            fflush(stdout);
+        }
+        MPI_Barrier(comm);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+    if (rank == 0) {
+        printf("MPI parallel processing completed in %.2f seconds.\n", total_end - total_start);
+    }
+
+    // 统计是集合操作，每个进程都要参与；只有 rank 0 打开报告文件
+    FILE* stats = rank == 0 ? stats_open(opt->stats_file) : NULL;
+#if STATS_ENABLED
+    if (opt->stats_file) {
+        mpi_stats_report(MPI_COMM_WORLD, stats,
+                         opt->backend == BACKEND_HYBRID ? "hybrid" : "mpi");
+    }
+#endif
+    stats_close(stats);
+
+    mpi_tables_free(&tables);
+    if (sketches) {
+        for (int t = 0; t < threads; t++) sketch_free(&sketches[t]);
+        free(sketches);
+    }
+    MPI_Comm_free(&comm);
+    return 0;
+}
+
+#endif
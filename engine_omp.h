@@ -0,0 +1,237 @@
+#ifndef ENGINE_OMP_H
+#define ENGINE_OMP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "driver.h"
+#include "hash_table.h"
+#include "mmap_reader.h"
+#include "radix_sort.h"
+#include "top_k.h"
+#include "omp_tables.h"
+#include "sketch.h"
+#include "checkpoint.h"
+#include "result_file.h"
+#include "stats.h"
+
+typedef struct {
+    SortEntry* data;
+    int size;
+    int capacity;
+} EntryList;
+
+// 把表中的条目写入 out，返回条目数
+static inline int collect_from_hashmap(HashMap* m, SortEntry* out) {
+    int n = 0;
+    for (unsigned int i = 0; i < m->capacity; i++) {
+        Slot* s = &m->slots[i];
+        if (s->key) {
+            out[n].key = s->key;
+            out[n].count = s->count;
+            n++;
+        }
+    }
+    return n;
+}
+
+// 用 tables->threads 个线程处理一个文件。phases 返回各阶段耗时：
+// 映射、解析计数、合并、排序、写出。打不开输入文件时返回 -1。
+// incremental 时只解析上次保存的位置之后的部分，见 checkpoint.h；binary 时输出二进制结果
+static inline int omp_process_file(OmpTables* tables, const char* input, const char* output,
+                                   int top_k, unsigned int table_size, bool incremental,
+                                   bool binary, double* phases) {
+    HashMap** shards = tables->shards;
+    double file_start = omp_get_wtime();
+    STATS_TIMER(t_read);
+
+    MappedFile f;
+    if (map_file(input, &f) != 0) {
+        fprintf(stderr, "Cannot open %s\n", input);
+        return -1;
+    }
+    size_t begin = 0, end = f.size;
+    MappedFile state = {NULL, 0};
+    bool saved = false;
+    if (incremental) {
+        saved = checkpoint_open(output, input, &f, &state) == 0;
+        if (saved) begin = checkpoint_header(&state)->offset;
+        end = checkpoint_line_end(&f, begin);
+    }
+    double t_map = omp_get_wtime();
+    STATS_ELAPSED(STAT_READ, t_read);
+
+    double t_count = 0;
+    int nt = omp_count_range(tables, &f, begin, end, table_size, &t_count);
+
+    // 增量模式：保存的状态按同样的规则并入各分片，写出新状态后再计入末尾的半行
+    if (incremental) {
+        STATS_TIMER(t_state);
+        if (saved && checkpoint_load(&state, shards, nt) != 0) {
+            fprintf(stderr, "State file of %s is truncated\n", output);
+            exit(1);
+        }
+        if (checkpoint_save_tables(output, input, &f, end, shards, nt) != 0) {
+            perror("Cannot write state file");
+            exit(1);
+        }
+        KeySlice tail;
+        if (checkpoint_partial_line(&f, end, &tail)) {
+            unsigned int h = hash_string(tail.ptr, tail.len);
+            hashmap_add_hashed(shards[hash_shard(h, nt)], tail.ptr, tail.len, h, 1);
+        }
+        STATS_ELAPSED(STAT_MERGE, t_state);
+    }
+    double t_merge = omp_get_wtime();
+    STATS_TIMER(t_collect);
+
+    int* offsets = (int*)calloc(nt + 1, sizeof(int));
+    TopK* heaps = (TopK*)calloc(nt, sizeof(TopK));
+    EntryList result;
+
+    // 按分片下标 p 用 omp for 分派，而不是按线程号：OMP_DYNAMIC 下这个区域的
+    // 线程数可能少于 nt，按 tid 取分片会漏掉后面的分片
+    #pragma omp parallel num_threads(nt)
+    {
+        // 各分片的键互不相交、计数已是最终值，可以各自先选出前 K 个
+        if (top_k > 0) {
+            #pragma omp for schedule(dynamic, 1)
+            for (int p = 0; p < nt; p++) {
+                HashMap* shard = shards[p];
+                topk_init(&heaps[p], top_k);
+                for (unsigned int j = 0; j < shard->capacity; j++) {
+                    Slot* s = &shard->slots[j];
+                    if (s->key) topk_offer(&heaps[p], s->key, s->count);
+                }
+            }
+        }
+
+        #pragma omp single
+        {
+            if (top_k > 0) {
+                TopK merged;
+                topk_init(&merged, top_k);
+                for (int p = 0; p < nt; p++) {
+                    for (int j = 0; j < heaps[p].size; j++) {
+                        topk_offer(&merged, heaps[p].data[j].key, heaps[p].data[j].count);
+                    }
+                    topk_free(&heaps[p]);
+                }
+                result.size = result.capacity = topk_finish(&merged);
+                result.data = merged.data;
+            } else {
+                for (int p = 0; p < nt; p++) offsets[p + 1] = offsets[p] + shards[p]->size;
+                result.size = result.capacity = offsets[nt];
+                result.data = (SortEntry*)malloc(sizeof(SortEntry) * (result.size > 0 ? result.size : 1));
+            }
+        }
+
+        if (top_k <= 0) {
+            #pragma omp for schedule(dynamic, 1)
+            for (int p = 0; p < nt; p++) collect_from_hashmap(shards[p], result.data + offsets[p]);
+        }
+    }
+    // 键已拷入各分片，映射可以释放
+    unmap_file(&f);
+    free(offsets);
+    free(heaps);
+
+    if (top_k <= 0) parallel_sort_by_count(result.data, result.size);
+    double t_sort = omp_get_wtime();
+    STATS_ELAPSED(STAT_SORT, t_collect);
+    STATS_TIMER(t_out);
+
+    // 文本结果由本文件的线程分片格式化后并行写出，见 result_file.h
+    int written = binary ? result_write_binary(output, result.data, result.size)
+                         : result_write_entries_text(output, result.data, result.size);
+    if (written != 0) perror("Cannot write output file");
+
+    omp_tables_clear(tables);
+    free(result.data);
+    double t_write = omp_get_wtime();
+    STATS_ELAPSED(STAT_WRITE, t_out);
+
+    phases[0] = t_map - file_start;
+    phases[1] = t_count - t_map;
+    phases[2] = t_merge - t_count;
+    phases[3] = t_sort - t_merge;
+    phases[4] = t_write - t_sort;
+    return 0;
+}
+
+// OpenMP 后端：每个文件用 threads 个线程处理；核数允许时外层再同时处理 jobs 个文件，
+// 每个外层线程各有一套表（嵌套并行）
+static inline int run_omp(const DriverOptions* opt) {
+    int threads = opt->threads > 0 ? opt->threads : omp_get_max_threads();
+    int auto_jobs = omp_get_num_procs() / threads;
+    int jobs = driver_jobs(opt, auto_jobs);
+    if (jobs > 1) omp_set_max_active_levels(2);
+
+    SketchParams sketch = sketch_params(opt->hll_error, opt->cm_epsilon, opt->cm_delta, opt->top_k);
+    if (opt->approx) sketch_params_report(&sketch);
+
+    double t0 = omp_get_wtime();
+
+    #pragma omp parallel num_threads(jobs) if (jobs > 1)
+    {
+        // 内层的并行区域和排序都按每个文件的线程数展开
+        omp_set_num_threads(threads);
+        OmpTables tables;
+        omp_tables_init(&tables, threads, opt->hot_keys);
+        // 近似模式每个线程一份 Sketch，与计数表互不相干
+        Sketch* sketches = NULL;
+        if (opt->approx) {
+            sketches = (Sketch*)malloc(sizeof(Sketch) * threads);
+            for (int t = 0; t < threads; t++) sketch_init(&sketches[t], &sketch);
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < opt->file_count; i++) {
+            const FileJob* f = &opt->files[i];
+            if (jobs == 1) printf("Processing file: %s -> %s\n", f->input, f->output);
+            double phases[5];
+            double file_start = omp_get_wtime();
+            if (opt->approx) {
+                if (sketch_process_file(sketches, threads, &sketch, f->input, f->output) != 0) continue;
+                double file_end = omp_get_wtime();
+                #pragma omp critical(omp_report)
+                {
+                    if (jobs > 1) printf("Processing file: %s -> %s\n", f->input, f->output);
+                    printf("File processed in %.3f seconds\n", file_end - file_start);
+                }
+                continue;
+            }
+            if (omp_process_file(&tables, f->input, f->output, opt->top_k, opt->table_size,
+                                 opt->incremental, opt->binary, phases) != 0) continue;
+            double file_end = omp_get_wtime();
+            // 同时处理多个文件时一个文件的报告一起打印，避免交错
+            #pragma omp critical(omp_report)
+            {
+                if (jobs > 1) printf("Processing file: %s -> %s\n", f->input, f->output);
+                printf("  map %.3f  parse+count %.3f  merge %.3f  sort %.3f  write %.3f\n",
+                       phases[0], phases[1], phases[2], phases[3], phases[4]);
+                printf("File processed in %.3f seconds\n", file_end - file_start);
+            }
+        }
+
+        omp_tables_free(&tables);
+        if (sketches) {
+            for (int t = 0; t < threads; t++) sketch_free(&sketches[t]);
+            free(sketches);
+        }
+    }
+
+    double t1 = omp_get_wtime();
+    printf("OMP parallel processing completed in %.2f seconds.\n", t1 - t0);
+
+    FILE* stats = stats_open(opt->stats_file);
+#if STATS_ENABLED
+    if (stats) stats_write_report(stats, "omp");
+#endif
+    stats_close(stats);
+    return 0;
+}
+
+#endif
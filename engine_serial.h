@@ -0,0 +1,208 @@
+#ifndef ENGINE_SERIAL_H
+#define ENGINE_SERIAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "driver.h"
+#include "hash_table.h"
+#include "mmap_reader.h"
+#include "radix_sort.h"
+#include "top_k.h"
+#include "spill.h"
+#include "sketch.h"
+#include "checkpoint.h"
+#include "result_file.h"
+#include "stats.h"
+
+#define SERIAL_HASH_CAPACITY (1 << 20)
+
+// map 在各文件之间复用，处理完后清空但保留内存。
+// memory_budget > 0 时哈希表超过预算就把有序段溢写到 spill_dir，见 spill.h；
+// incremental 时只解析上次保存的位置之后的部分，见 checkpoint.h；binary 时输出二进制结果
+static inline void serial_process_file(HashMap* map, const char* input_file, const char* output_file,
+                                       int top_k, size_t memory_budget, const char* spill_dir,
+                                       bool incremental, bool binary) {
+    STATS_TIMER(t_read);
+    MappedFile file;
+    if (map_file(input_file, &file) != 0) {
+        perror("Cannot open input file");
+        exit(1);
+    }
+    size_t begin = 0, end = file.size;
+    MappedFile state = {NULL, 0};
+    bool saved = false;
+    if (incremental) {
+        saved = checkpoint_open(output_file, input_file, &file, &state) == 0;
+        if (saved) begin = checkpoint_header(&state)->offset;
+        end = checkpoint_line_end(&file, begin);
+    }
+    STATS_ELAPSED(STAT_READ, t_read);
+    
+    unsigned int capacity = map->capacity;
+    MapStream stream;
+    LineReader reader;
+    LineBatch batch;
+    map_stream_init(&stream, &file, begin, end);
+    
+    SpillSet spill;
+    spill_init(&spill, spill_dir, memory_budget);
+    
+    // 按批插入，每批之后检查一次预算，最多超出一批新键的大小；
+    // 输入按 MapStream 分块解析，驻留的输入页不随文件大小增长
+    STATS_TIMER(t_count);
+    while (map_stream_next(&stream, &reader)) {
+        while (line_reader_next_batch(&reader, &batch)) {
+            unsigned int before = map->size;
+            hashmap_add_batch(map, &batch);
+            if (memory_budget > 0 && map->size != before && hashmap_memory(map) > memory_budget) {
+                spill_table(&spill, map);
+                hashmap_reset(map, capacity);
+            }
+        }
+    }
+    STATS_ELAPSED(STAT_COUNT, t_count);
+
+    // 增量模式：并入保存的状态、写出新状态，末尾的半行只计入本次输出
+    if (incremental) {
+        STATS_TIMER(t_state);
+        if (saved && checkpoint_load(&state, &map, 1) != 0) {
+            fprintf(stderr, "State file of %s is truncated\n", output_file);
+            exit(1);
+        }
+        if (checkpoint_save_tables(output_file, input_file, &file, end, &map, 1) != 0) {
+            perror("Cannot write state file");
+            exit(1);
+        }
+        KeySlice tail;
+        if (checkpoint_partial_line(&file, end, &tail)) hashmap_add(map, tail.ptr, tail.len, 1);
+        STATS_ELAPSED(STAT_MERGE, t_state);
+    }
+    unmap_file(&file);
+    
+    // 发生过溢写：剩余的表也写成一段，归并后直接输出
+    if (spill.run_count > 0) {
+        STATS_TIMER(t_spill);
+        spill_table(&spill, map);
+        hashmap_reset(map, capacity);
+        spill_finish(&spill, output_file, top_k);
+        STATS_ELAPSED(STAT_MERGE, t_spill);
+        return;
+    }
+    
+    // 收集所有条目，键直接引用哈希表中保存的副本
+    STATS_TIMER(t_sort);
+    int unique_count = map->size;
+    SortEntry* entries;
+    if (top_k > 0) {
+        // 只要前 K 个：用容量为 K 的堆筛选，不必排序全部条目
+        TopK heap;
+        topk_init(&heap, top_k);
+        for (unsigned int i = 0; i < map->capacity; i++) {
+            Slot* s = &map->slots[i];
+            if (s->key) topk_offer(&heap, s->key, s->count);
+        }
+        unique_count = topk_finish(&heap);
+        entries = heap.data;
+    } else {
+        entries = (SortEntry*)malloc(unique_count * sizeof(SortEntry));
+        int index = 0;
+        for (unsigned int i = 0; i < map->capacity; i++) {
+            Slot* s = &map->slots[i];
+            if (!s->key) continue;
+            entries[index].key = s->key;
+            entries[index].count = s->count;
+            index++;
+        }
+        
+        // 排序：频率降序，字典序升序
+        sort_by_count(entries, unique_count);
+    }
+    
+    STATS_ELAPSED(STAT_SORT, t_sort);
+    
+    // 写入输出文件
+    STATS_TIMER(t_write);
+    int written = binary ? result_write_binary(output_file, entries, unique_count)
+                         : result_write_entries_text(output_file, entries, unique_count);
+    if (written != 0) {
+        perror("Cannot write output file");
+        exit(1);
+    }
+    free(entries);
+    hashmap_clear(map);
+    STATS_ELAPSED(STAT_WRITE, t_write);
+}
+
+// 串行后端：每个文件由一个线程处理。以 -fopenmp 编译时可以同时处理 jobs 个文件，
+// 每个线程有自己的哈希表；未启用 OpenMP 时逐个处理
+static inline int run_serial(const DriverOptions* opt) {
+    // 有预算时初始槽位数组不超过预算的 1/4，避免表一建出来就超限
+    unsigned int capacity = opt->table_size ? opt->table_size : SERIAL_HASH_CAPACITY;
+    if (opt->memory_budget > 0 && opt->memory_budget / (4 * sizeof(Slot)) < capacity) {
+        capacity = opt->memory_budget / (4 * sizeof(Slot));
+    }
+
+    int jobs = 1;
+#ifdef _OPENMP
+    jobs = driver_jobs(opt, omp_get_num_procs());
+#endif
+
+    SketchParams sketch = sketch_params(opt->hll_error, opt->cm_epsilon, opt->cm_delta, opt->top_k);
+    if (opt->approx) sketch_params_report(&sketch);
+
+    double start_time = driver_now();
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(jobs) if (jobs > 1)
+#endif
+    {
+        // 近似模式只用一份固定大小的 Sketch，不建哈希表
+        HashMap* map = opt->approx ? NULL : create_hashmap(capacity);
+        Sketch sk;
+        if (opt->approx) sketch_init(&sk, &sketch);
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int i = 0; i < opt->file_count; i++) {
+            const FileJob* f = &opt->files[i];
+            if (jobs == 1) printf("Processing: %s -> %s\n", f->input, f->output);
+            double file_start = driver_now();
+            if (opt->approx) {
+                if (sketch_process_file(&sk, 1, &sketch, f->input, f->output) != 0) exit(1);
+            } else {
+                serial_process_file(map, f->input, f->output, opt->top_k, opt->memory_budget, opt->spill_dir,
+                                    opt->incremental, opt->binary);
+            }
+            double file_end = driver_now();
+            // 同时处理多个文件时两行一起打印，避免与其他文件的输出交错
+#ifdef _OPENMP
+            #pragma omp critical(serial_report)
+#endif
+            {
+                if (jobs > 1) printf("Processing: %s -> %s\n", f->input, f->output);
+                printf("  Time: %.3f seconds\n", file_end - file_start);
+            }
+        }
+
+        if (opt->approx) sketch_free(&sk);
+        else destroy_hashmap(map);
+    }
+
+    double end_time = driver_now();
+    printf("Total processing time: %.2f seconds\n", end_time - start_time);
+
+    FILE* stats = stats_open(opt->stats_file);
+#if STATS_ENABLED
+    if (stats) stats_write_report(stats, "serial");
+#endif
+    stats_close(stats);
+    return 0;
+}
+
+#endif
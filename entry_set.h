@@ -0,0 +1,312 @@
+#ifndef ENTRY_SET_H
+#define ENTRY_SET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "hash_table.h"
+#include "radix_sort.h"
+
+// 变长键的条目集合：所有键首尾相接存放在一块连续的字符串区中（各自以 '\0' 结尾），
+// 条目只记录 (偏移, 长度, 次数, 哈希)，共 16 字节。排序、归并和进程间交换移动的是
+// 条目和键的实际字节，不再是定长的 char[MAX_KEY_LEN]。
+// 条目顺序与键在字符串区中的顺序一致时称集合是"紧凑"的：任意一段连续的条目对应
+// 字符串区中连续的一段字节，可以与条目一起直接作为消息发送。
+
+typedef struct {
+    unsigned int offset;    // 键在字符串区中的起始位置
+    unsigned int len;       // 键长，不含结尾的 '\0'
+    int count;
+    unsigned int hash;
+} KeyEntry;
+
+typedef struct {
+    KeyEntry* entries;
+    int size;
+    int capacity;
+    char* strings;
+    size_t bytes;           // 字符串区已用的字节数
+    size_t bytes_capacity;
+} EntrySet;
+
+static inline void entryset_init(EntrySet* s) {
+    s->entries = NULL;
+    s->size = 0;
+    s->capacity = 0;
+    s->strings = NULL;
+    s->bytes = 0;
+    s->bytes_capacity = 0;
+}
+
+static inline void entryset_free(EntrySet* s) {
+    free(s->entries);
+    free(s->strings);
+    entryset_init(s);
+}
+
+// 至少能放下 n 个条目和 bytes 字节的键
+static inline void entryset_reserve(EntrySet* s, int n, size_t bytes) {
+    if (n > s->capacity) {
+        int cap = s->capacity ? s->capacity : 16;
+        while (cap < n) cap *= 2;
+        s->entries = (KeyEntry*)realloc(s->entries, sizeof(KeyEntry) * cap);
+        if (!s->entries) {
+            fprintf(stderr, "EntrySet alloc failed (%d entries)\n", cap);
+            exit(1);
+        }
+        s->capacity = cap;
+    }
+    if (bytes > s->bytes_capacity) {
+        size_t cap = s->bytes_capacity ? s->bytes_capacity : 256;
+        while (cap < bytes) cap *= 2;
+        s->strings = (char*)realloc(s->strings, cap);
+        if (!s->strings) {
+            fprintf(stderr, "EntrySet alloc failed (%zu bytes)\n", cap);
+            exit(1);
+        }
+        s->bytes_capacity = cap;
+    }
+}
+
+static inline const char* entryset_key(const EntrySet* s, int i) {
+    return s->strings + s->entries[i].offset;
+}
+
+static inline void entryset_push(EntrySet* s, const char* key, size_t len,
+                                 int count, unsigned int hash) {
+    entryset_reserve(s, s->size + 1, s->bytes + len + 1);
+    KeyEntry* e = &s->entries[s->size++];
+    e->offset = (unsigned int)s->bytes;
+    e->len = (unsigned int)len;
+    e->count = count;
+    e->hash = hash;
+    memcpy(s->strings + s->bytes, key, len);
+    s->strings[s->bytes + len] = '\0';
+    s->bytes += len + 1;
+}
+
+// 把 n 张表中的条目依次追加到集合末尾。启用 OpenMP 时各表由不同线程展开：
+// 先统计每张表的条目数和键字节数，求前缀和后各自写入自己的区段
+static inline void entryset_from_tables(EntrySet* s, HashMap* const* tables, int n) {
+    int* counts = (int*)calloc(n + 1, sizeof(int));
+    size_t* bytes = (size_t*)calloc(n + 1, sizeof(size_t));
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+    for (int t = 0; t < n; t++) {
+        const HashMap* m = tables[t];
+        size_t b = 0;
+        for (unsigned int i = 0; i < m->capacity; i++) {
+            if (m->slots[i].key) b += strlen(m->slots[i].key) + 1;
+        }
+        counts[t + 1] = (int)m->size;
+        bytes[t + 1] = b;
+    }
+    counts[0] = s->size;
+    bytes[0] = s->bytes;
+    for (int t = 0; t < n; t++) {
+        counts[t + 1] += counts[t];
+        bytes[t + 1] += bytes[t];
+    }
+    entryset_reserve(s, counts[n], bytes[n]);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if (n > 1)
+#endif
+    for (int t = 0; t < n; t++) {
+        const HashMap* m = tables[t];
+        int k = counts[t];
+        size_t off = bytes[t];
+        for (unsigned int i = 0; i < m->capacity; i++) {
+            const Slot* slot = &m->slots[i];
+            if (!slot->key) continue;
+            size_t len = strlen(slot->key);
+            KeyEntry* e = &s->entries[k++];
+            e->offset = (unsigned int)off;
+            e->len = (unsigned int)len;
+            e->count = slot->count;
+            e->hash = slot->hash;
+            memcpy(s->strings + off, slot->key, len + 1);
+            off += len + 1;
+        }
+    }
+    s->size = counts[n];
+    s->bytes = bytes[n];
+    free(counts);
+    free(bytes);
+}
+
+static inline void entryset_from_table(EntrySet* s, HashMap* m) {
+    entryset_from_tables(s, &m, 1);
+}
+
+// 用 radix_sort.h 的排序引擎排序（按次数或按键），排序后把键按新顺序重新排进字符串区，
+// 结果是紧凑的。启用 OpenMP 时排序和重排都用当前的线程数并行
+static inline void entryset_sort(EntrySet* s, int by_count) {
+    int n = s->size;
+    if (n < 1) return;
+    SortEntry* refs = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    for (int i = 0; i < n; i++) {
+        refs[i].key = entryset_key(s, i);
+        refs[i].count = s->entries[i].count;
+        refs[i].tag = i;
+    }
+#ifdef _OPENMP
+    if (by_count) parallel_sort_by_count(refs, n);
+    else parallel_sort_by_key(refs, n);
+#else
+    if (by_count) sort_by_count(refs, n);
+    else sort_by_key(refs, n);
+#endif
+
+    KeyEntry* entries = (KeyEntry*)malloc(sizeof(KeyEntry) * s->capacity);
+    char* strings = (char*)malloc(s->bytes_capacity > 0 ? s->bytes_capacity : 1);
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) {
+        KeyEntry e = s->entries[refs[i].tag];
+        e.offset = (unsigned int)bytes;
+        bytes += e.len + 1;
+        entries[i] = e;
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for if (n >= RADIX_PARALLEL_MIN)
+#endif
+    for (int i = 0; i < n; i++) {
+        memcpy(strings + entries[i].offset, refs[i].key, entries[i].len + 1);
+    }
+    free(refs);
+    free(s->entries);
+    free(s->strings);
+    s->entries = entries;
+    s->strings = strings;
+    s->bytes = bytes;
+}
+
+// 前缀压缩（front coding）：按键有序的一段条目中相邻的键往往有很长的公共前缀，
+// 每个条目编码为 [与上一个键的公共前缀长度][后缀长度][后缀字节][次数（varint）]，
+// 两个长度都小于 MAX_KEY_LEN，各占 1 字节；段内第一个键的公共前缀为 0，各段可以独立解码。
+// 哈希不编码，解码时重新计算
+#define FRONT_ENTRY_MAX (2 + MAX_KEY_LEN + 5)
+
+static inline size_t varint_put(char* dst, unsigned int v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        dst[n++] = (char)(v | 0x80);
+        v >>= 7;
+    }
+    dst[n++] = (char)v;
+    return n;
+}
+
+static inline const char* varint_get(const char* src, unsigned int* v) {
+    unsigned int x = 0;
+    int shift = 0;
+    unsigned char b;
+    do {
+        b = (unsigned char)*src++;
+        x |= (unsigned int)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    *v = x;
+    return src;
+}
+
+// 把按键有序的条目 [begin, end) 编码到 dst（至少 (end - begin) * FRONT_ENTRY_MAX 字节），
+// 返回写入的字节数
+static inline size_t entryset_encode_front(const EntrySet* s, int begin, int end, char* dst) {
+    char* p = dst;
+    const char* prev = NULL;
+    unsigned int prev_len = 0;
+    for (int i = begin; i < end; i++) {
+        const KeyEntry* e = &s->entries[i];
+        const char* key = entryset_key(s, i);
+        unsigned int shared = 0;
+        unsigned int limit = prev_len < e->len ? prev_len : e->len;
+        while (shared < limit && prev[shared] == key[shared]) shared++;
+        p[0] = (char)shared;
+        p[1] = (char)(e->len - shared);
+        memcpy(p + 2, key + shared, e->len - shared);
+        p += 2 + e->len - shared;
+        p += varint_put(p, (unsigned int)e->count);
+        prev = key;
+        prev_len = e->len;
+    }
+    return (size_t)(p - dst);
+}
+
+// 解码 entryset_encode_front 写出的 n 字节，条目依次追加到 s 末尾。
+// 键总是按定长 FRONT_KEY_COPY 字节整块复制：编译期定长的复制展开成几条向量读写，
+// 变长的小 memcpy 紧接着被读回时会打断写后读的转发，解码慢好几倍。
+// 为此 src + n 之后须至少还有 FRONT_KEY_COPY 字节可读（内容任意）
+#define FRONT_KEY_COPY (MAX_KEY_LEN - 1)
+
+static inline void entryset_decode_front(EntrySet* s, const char* src, size_t n) {
+    const char* p = src;
+    const char* end = src + n;
+    char key[2 * FRONT_KEY_COPY];
+    while (p < end) {
+        unsigned int shared = (unsigned char)p[0];
+        unsigned int suffix = (unsigned char)p[1];
+        unsigned int len = shared + suffix;
+        memcpy(key + shared, p + 2, FRONT_KEY_COPY);
+        p += 2 + suffix;
+        unsigned int count;
+        p = varint_get(p, &count);
+
+        entryset_reserve(s, s->size + 1, s->bytes + FRONT_KEY_COPY + 1);
+        char* dst = s->strings + s->bytes;
+        memcpy(dst, key, FRONT_KEY_COPY);
+        dst[len] = '\0';
+        KeyEntry* e = &s->entries[s->size++];
+        e->offset = (unsigned int)s->bytes;
+        e->len = len;
+        e->count = (int)count;
+        e->hash = hash_string(dst, len);
+        s->bytes += len + 1;
+    }
+}
+
+// 按当前的条目顺序重排字符串区，只移动过条目的集合（如 merge_runs 之后）由此重新变为紧凑
+static inline void entryset_compact(EntrySet* s) {
+    char* strings = (char*)malloc(s->bytes_capacity > 0 ? s->bytes_capacity : 1);
+    size_t bytes = 0;
+    for (int i = 0; i < s->size; i++) {
+        KeyEntry* e = &s->entries[i];
+        memcpy(strings + bytes, s->strings + e->offset, e->len + 1);
+        e->offset = (unsigned int)bytes;
+        bytes += e->len + 1;
+    }
+    free(s->strings);
+    s->strings = strings;
+    s->bytes = bytes;
+}
+
+// 紧凑集合中条目 [lo, hi) 的键所占的字节区间：起点写入 *begin，返回字节数
+static inline size_t entryset_span(const EntrySet* s, int lo, int hi, size_t* begin) {
+    if (lo >= hi) {
+        *begin = 0;
+        return 0;
+    }
+    const KeyEntry* last = &s->entries[hi - 1];
+    *begin = s->entries[lo].offset;
+    return last->offset + last->len + 1 - *begin;
+}
+
+// 收到 runs 段条目和对应的键字节后修正偏移：第 r 段的条目位于 [displs[r], displs[r+1])，
+// 键位于字符串区的 byte_displs[r] 处；发送方按 entryset_span 发送，段内第一个条目的
+// 偏移就是那段键字节的起点
+static inline void entryset_rebase(EntrySet* s, const int* displs, const int* byte_displs, int runs) {
+    for (int r = 0; r < runs; r++) {
+        if (displs[r] == displs[r + 1]) continue;
+        unsigned int base = s->entries[displs[r]].offset;
+        for (int i = displs[r]; i < displs[r + 1]; i++) {
+            s->entries[i].offset = s->entries[i].offset - base + (unsigned int)byte_displs[r];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,121 @@
+import argparse
+import bisect
+import os
+import random
+import string
+import sys
+
+# 生成与 dataset/data_{8,16,24}_{1M,10M,40M}.txt 同样形状的合成输入：每行一个定长键。
+# 键的全集大小 = 行数 × distinct-ratio，按 Zipf(s) 分布抽样（s = 0 为均匀分布），
+# 排名第 i 的键权重为 1 / i^s；同一组参数和种子总是生成完全相同的文件。
+#
+# 用法:
+#   python3 gen_dataset.py --key-len 16 --lines 10M --zipf 1.1 -o data/zipf.txt
+#   python3 gen_dataset.py --all --out-dir dataset      # 生成全部 9 个标准数据集
+
+ALPHABET = string.ascii_lowercase + string.digits
+STANDARD_KEY_LENS = (8, 16, 24)
+STANDARD_LINES = ("1M", "10M", "40M")
+CHUNK_LINES = 1 << 20
+
+
+def parse_count(text):
+    """解析 1M / 10M / 500K 之类的行数"""
+    text = text.strip().upper()
+    scale = {"K": 10 ** 3, "M": 10 ** 6, "G": 10 ** 9}.get(text[-1:], 1)
+    if text[-1:] in "KMG":
+        text = text[:-1]
+    return int(float(text) * scale)
+
+
+def standard_name(key_len, lines_text):
+    """标准数据集的文件名，与 driver.h 中的默认文件列表一致"""
+    return f"data_{key_len}_{lines_text}.txt"
+
+
+def make_keys(rng, count, key_len):
+    """生成 count 个互不相同的定长键，顺序随机（热门键不会集中在字典序的一端）"""
+    limit = len(ALPHABET) ** key_len
+    if count > limit:
+        raise ValueError(f"cannot make {count} distinct keys of length {key_len}")
+    seen = set()
+    keys = []
+    while len(keys) < count:
+        key = "".join(rng.choices(ALPHABET, k=key_len))
+        if key not in seen:
+            seen.add(key)
+            keys.append(key)
+    return keys
+
+
+def zipf_cum_weights(count, s):
+    total = 0.0
+    cum = []
+    for i in range(1, count + 1):
+        total += 1.0 / (i ** s)
+        cum.append(total)
+    return cum
+
+
+def generate(path, lines, key_len, distinct_ratio, zipf, seed):
+    """写出一个数据集，返回实际出现的不同键数"""
+    rng = random.Random(seed)
+    distinct = max(1, min(lines, int(lines * distinct_ratio)))
+    keys = make_keys(rng, distinct, key_len)
+    cum = zipf_cum_weights(distinct, zipf) if zipf > 0 else None
+    used = bytearray(distinct)
+
+    directory = os.path.dirname(path)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    tmp = path + ".tmp"
+    with open(tmp, "w") as f:
+        remaining = lines
+        while remaining > 0:
+            n = min(remaining, CHUNK_LINES)
+            if cum is None:
+                picks = [rng.randrange(distinct) for _ in range(n)]
+            else:
+                total = cum[-1]
+                picks = [bisect.bisect_left(cum, rng.random() * total) for _ in range(n)]
+            for p in picks:
+                used[p] = 1
+            f.write("\n".join(keys[p] for p in picks))
+            f.write("\n")
+            remaining -= n
+    os.replace(tmp, path)
+    return sum(used)
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description="generate synthetic group-by inputs")
+    ap.add_argument("-o", "--output", help="output file (single dataset)")
+    ap.add_argument("--lines", default="1M", help="number of lines, e.g. 1M, 10M, 40M")
+    ap.add_argument("--key-len", type=int, default=16, help="key length in characters (< 33)")
+    ap.add_argument("--distinct-ratio", type=float, default=0.1,
+                    help="size of the key universe as a fraction of the line count")
+    ap.add_argument("--zipf", type=float, default=0.0, help="Zipf exponent s, 0 = uniform")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--all", action="store_true",
+                    help="generate data_{8,16,24}_{1M,10M,40M}.txt into --out-dir")
+    ap.add_argument("--out-dir", default="dataset")
+    args = ap.parse_args(argv)
+
+    if args.key_len < 1 or args.key_len >= 33:
+        ap.error("--key-len must be between 1 and 32 (engines skip keys of 33+ characters)")
+
+    if args.all:
+        jobs = [(os.path.join(args.out_dir, standard_name(k, n)), parse_count(n), k)
+                for k in STANDARD_KEY_LENS for n in STANDARD_LINES]
+    elif args.output:
+        jobs = [(args.output, parse_count(args.lines), args.key_len)]
+    else:
+        ap.error("give -o FILE or --all")
+
+    for path, lines, key_len in jobs:
+        used = generate(path, lines, key_len, args.distinct_ratio, args.zipf, args.seed)
+        print(f"{path}: {lines} lines, {used} distinct keys", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "driver.h"
+#include "engine_serial.h"
+#include "engine_omp.h"
+#include "engine_mpi.h"
+
+// 统一入口：--backend serial|omp|mpi|hybrid 选择后端，其余参数见 driver.h。
+// 编译: mpic++ -O2 -fopenmp groupby.cpp -o groupby
+// 例:   ./groupby --backend omp --threads 8 --glob 'data/*.txt' --output-dir results
+//       mpirun -np 4 ./groupby --backend mpi --shuffle --manifest files.txt
+//       mpirun -np 2 --map-by socket ./groupby --backend hybrid --threads 16
+// 只有 mpi/hybrid 后端才初始化 MPI，serial/omp 后端可以不经 mpirun 直接运行。
+int main(int argc, char* argv[]) {
+    bool use_mpi = false;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--backend") == 0 && (strcmp(argv[i + 1], "mpi") == 0 ||
+                                                 strcmp(argv[i + 1], "hybrid") == 0)) {
+            use_mpi = true;
+        }
+    }
+
+    int rank = 0;
+    if (use_mpi) {
+        // 混合后端只在主线程调用 MPI
+        int provided;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    }
+
+    DriverOptions opt;
+    int rc = 1;
+    if (driver_parse(argc, argv, &opt, BACKEND_SERIAL, true, rank == 0) == 0) {
+        if (opt.backend == BACKEND_SERIAL) rc = run_serial(&opt);
+        else if (opt.backend == BACKEND_OMP) rc = run_omp(&opt);
+        else rc = run_mpi(&opt);
+        driver_free(&opt);
+    }
+
+    if (use_mpi) MPI_Finalize();
+    return rc;
+}
@@ -0,0 +1,176 @@
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "simd_kernels.h"
+#include "stats.h"
+
+// 三个版本共用的开放定址哈希表（线性探测）。
+// 槽位只有 16 字节：键指针 + 哈希指纹 + 计数，一个缓存行放 4 个槽，
+// 探测时先比较指纹，命中后才去比较键。键本身存放在 Arena 中，扩容只搬动槽位。
+
+#define MAX_KEY_LEN 33
+
+typedef struct {
+    const char* key;    // NULL 表示空槽
+    unsigned int hash;
+    int count;
+} Slot;
+
+typedef struct {
+    Slot* slots;
+    unsigned int capacity;  // 2 的幂
+    unsigned int mask;
+    unsigned int size;
+    Arena keys;
+} HashMap;
+
+// 哈希由 simd_kernels.h 按 CPU 选择实现，各级别结果相同
+static inline unsigned int hash_string(const char* str, size_t len) {
+    return simd_kernels.hash(str, len);
+}
+
+// 用哈希的高位选分片，与用低位定位槽位的探测互不干扰
+static inline int hash_shard(unsigned int h, int shards) {
+    return (int)(((unsigned long long)h * (unsigned int)shards) >> 32);
+}
+
+static inline void* hashmap_alloc(size_t bytes) {
+    void* p = malloc(bytes);
+    if (!p) {
+        fprintf(stderr, "HashMap alloc failed (%zu bytes)\n", bytes);
+        exit(1);
+    }
+    return p;
+}
+
+static inline HashMap* create_hashmap(unsigned int capacity) {
+    unsigned int cap = 16;
+    while (cap < capacity) cap <<= 1;
+
+    HashMap* m = (HashMap*)hashmap_alloc(sizeof(HashMap));
+    m->capacity = cap;
+    m->mask = cap - 1;
+    m->size = 0;
+    arena_init(&m->keys);
+    m->slots = (Slot*)calloc(cap, sizeof(Slot));
+    if (!m->slots) {
+        fprintf(stderr, "HashMap alloc failed (%u slots)\n", cap);
+        exit(1);
+    }
+    return m;
+}
+
+static inline const char* hashmap_store_key(HashMap* m, const char* key, size_t len) {
+    char* dst = (char*)arena_alloc(&m->keys, len + 1);
+    memcpy(dst, key, len);
+    dst[len] = '\0';
+    return dst;
+}
+
+static inline void hashmap_grow(HashMap* m) {
+    STATS_ADD(STAT_RESIZES, 1);
+    unsigned int new_cap = m->capacity << 1;
+    unsigned int new_mask = new_cap - 1;
+    Slot* new_slots = (Slot*)calloc(new_cap, sizeof(Slot));
+    if (!new_slots) {
+        fprintf(stderr, "HashMap grow failed (%u slots)\n", new_cap);
+        exit(1);
+    }
+    for (unsigned int i = 0; i < m->capacity; i++) {
+        Slot* s = &m->slots[i];
+        if (!s->key) continue;
+        unsigned int idx = s->hash & new_mask;
+        while (new_slots[idx].key) idx = (idx + 1) & new_mask;
+        new_slots[idx] = *s;
+    }
+    free(m->slots);
+    m->slots = new_slots;
+    m->capacity = new_cap;
+    m->mask = new_mask;
+}
+
+// 已知哈希值时直接插入，合并其他表时可省去重新计算
+static inline void hashmap_add_hashed(HashMap* m, const char* key, size_t len,
+                                      unsigned int h, int cnt) {
+    unsigned int idx = h & m->mask;
+    unsigned int probes = 0;
+    STATS_ADD(STAT_LOOKUPS, 1);
+    while (1) {
+        Slot* s = &m->slots[idx];
+        if (!s->key) break;
+        if (s->hash == h && simd_kernels.equal(s->key, key, len) && s->key[len] == '\0') {
+            s->count += cnt;
+            STATS_ADD(STAT_PROBES, probes);
+            STATS_MAX(STAT_PROBE_MAX, probes);
+            return;
+        }
+        idx = (idx + 1) & m->mask;
+        probes++;
+    }
+    STATS_ADD(STAT_PROBES, probes);
+    STATS_MAX(STAT_PROBE_MAX, probes);
+    STATS_ADD(STAT_NEW_KEYS, 1);
+
+    // 负载因子超过 1/2 时扩容，之后重新定位空槽
+    if ((m->size + 1) * 2 > m->capacity) {
+        hashmap_grow(m);
+        idx = h & m->mask;
+        while (m->slots[idx].key) idx = (idx + 1) & m->mask;
+    }
+
+    Slot* s = &m->slots[idx];
+    s->key = hashmap_store_key(m, key, len);
+    s->hash = h;
+    s->count = cnt;
+    m->size++;
+}
+
+// 预取哈希值 h 的起始槽位，批量插入时先为整批键发出预取，访存延迟可以相互重叠
+static inline void hashmap_prefetch(const HashMap* m, unsigned int h) {
+    __builtin_prefetch(&m->slots[h & m->mask]);
+}
+
+static inline void hashmap_add(HashMap* m, const char* key, size_t len, int cnt) {
+    hashmap_add_hashed(m, key, len, hash_string(key, len), cnt);
+}
+
+// 槽位数组与键合计占用的内存
+static inline size_t hashmap_memory(const HashMap* m) {
+    return (size_t)m->capacity * sizeof(Slot) + m->keys.bytes;
+}
+
+// 清空表以便处理下一个文件：槽位数组和键的内存都保留复用
+static inline void hashmap_clear(HashMap* m) {
+    if (m->size > 0) memset(m->slots, 0, sizeof(Slot) * m->capacity);
+    m->size = 0;
+    arena_reset(&m->keys);
+}
+
+// 清空表并归还内存：键的块全部释放，槽位数组按 capacity 重新分配
+static inline void hashmap_reset(HashMap* m, unsigned int capacity) {
+    unsigned int cap = 16;
+    while (cap < capacity) cap <<= 1;
+    free(m->slots);
+    m->slots = (Slot*)calloc(cap, sizeof(Slot));
+    if (!m->slots) {
+        fprintf(stderr, "HashMap alloc failed (%u slots)\n", cap);
+        exit(1);
+    }
+    m->capacity = cap;
+    m->mask = cap - 1;
+    m->size = 0;
+    arena_free(&m->keys);
+}
+
+static inline void destroy_hashmap(HashMap* m) {
+    arena_free(&m->keys);
+    free(m->slots);
+    free(m);
+}
+
+#endif
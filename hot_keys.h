@@ -0,0 +1,125 @@
+#ifndef HOT_KEYS_H
+#define HOT_KEYS_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_table.h"
+#include "mmap_reader.h"
+
+// 热点键（heavy hitter）：Zipf 分布的输入里少数几个键占了大部分行。
+// 计数前先在区间上均匀抽取 HOT_SAMPLE_BLOCKS 段、每段约 HOT_SAMPLE_BLOCK_LINES 行，
+// 精确统计样本后取出占比不低于 1/HOT_SHARE_MIN 的键，最多 limit 个。
+// 计数时每批键先查这张小表，命中的只在线程/进程私有的计数数组里加一，不进入大哈希表，
+// 也就不再反复探测同一个槽位；最后再把私有计数按键的归属合并进表。
+// 热点键合计不到样本的 1/HOT_COVERAGE_MIN 时，查小表的开销抵不过省下的探测，视为没有热点键；
+// 没有热点键时（均匀或轻度偏斜）整个查表步骤直接跳过。
+
+#define HOT_KEYS_MAX 64
+#define HOT_SAMPLE_BLOCKS 64
+#define HOT_SAMPLE_BLOCK_LINES 1024
+#define HOT_SHARE_MIN 1024
+#define HOT_COVERAGE_MIN 4
+#define HOT_SLOTS 128
+
+typedef struct {
+    int size;
+    unsigned int hashes[HOT_KEYS_MAX];
+    unsigned char lens[HOT_KEYS_MAX];
+    char keys[HOT_KEYS_MAX][MAX_KEY_LEN];
+    unsigned char slots[HOT_SLOTS];     // 以哈希低位定位的小表，存下标 + 1，0 为空
+} HotKeys;
+
+static inline void hot_keys_clear(HotKeys* hk) {
+    hk->size = 0;
+    memset(hk->slots, 0, sizeof(hk->slots));
+}
+
+// 在 f 的 [lo, hi) 上抽样检测热点键，结果写入 hk（键拷贝到 hk 内，映射释放后仍可用）
+static inline void hot_keys_detect(HotKeys* hk, const MappedFile* f, size_t lo, size_t hi, int limit) {
+    hot_keys_clear(hk);
+    if (limit > HOT_KEYS_MAX) limit = HOT_KEYS_MAX;
+    if (limit <= 0 || hi <= lo) return;
+
+    // 样本很小，直接精确计数
+    HashMap* sample = create_hashmap(HOT_SAMPLE_BLOCKS * HOT_SAMPLE_BLOCK_LINES * 2);
+    int sampled = 0;
+    for (int b = 0; b < HOT_SAMPLE_BLOCKS; b++) {
+        size_t begin = line_start_after(f, lo + (hi - lo) / HOT_SAMPLE_BLOCKS * b);
+        if (begin >= hi) break;
+        LineReader reader;
+        LineBatch batch;
+        line_reader_init(&reader, f->data + begin, f->data + hi);
+        for (int i = 0; i < HOT_SAMPLE_BLOCK_LINES && line_reader_next_batch(&reader, &batch); i += LINE_BATCH) {
+            hashmap_add_batch(sample, &batch);
+            sampled += batch.size;
+        }
+    }
+
+    // 达到阈值的候选不超过 HOT_SHARE_MIN 个，先收集出来，再依次取出计数最大的一个
+    int threshold = sampled / HOT_SHARE_MIN;
+    if (threshold < 2) threshold = 2;
+    Slot* cand[HOT_SHARE_MIN];
+    int n = 0;
+    for (unsigned int i = 0; i < sample->capacity && n < HOT_SHARE_MIN; i++) {
+        Slot* s = &sample->slots[i];
+        if (s->key && s->count >= threshold) cand[n++] = s;
+    }
+    int covered = 0;
+    while (hk->size < limit && n > 0) {
+        int best = 0;
+        for (int i = 1; i < n; i++) {
+            if (cand[i]->count > cand[best]->count) best = i;
+        }
+        const Slot* top = cand[best];
+        cand[best] = cand[--n];
+        covered += top->count;
+        int k = hk->size++;
+        size_t len = strlen(top->key);
+        hk->hashes[k] = top->hash;
+        hk->lens[k] = (unsigned char)len;
+        memcpy(hk->keys[k], top->key, len + 1);
+        unsigned int h = top->hash & (HOT_SLOTS - 1);
+        while (hk->slots[h]) h = (h + 1) & (HOT_SLOTS - 1);
+        hk->slots[h] = (unsigned char)(k + 1);
+    }
+    destroy_hashmap(sample);
+    if ((long long)covered * HOT_COVERAGE_MIN < sampled) hot_keys_clear(hk);
+}
+
+// 返回热点键的下标，不是热点键返回 -1
+static inline int hot_keys_find(const HotKeys* hk, const char* key, size_t len, unsigned int h) {
+    unsigned int s = h & (HOT_SLOTS - 1);
+    while (hk->slots[s]) {
+        int k = hk->slots[s] - 1;
+        if (hk->hashes[k] == h && hk->lens[k] == len && memcmp(hk->keys[k], key, len) == 0) return k;
+        s = (s + 1) & (HOT_SLOTS - 1);
+    }
+    return -1;
+}
+
+// 把批中的热点键计入 counts 并从批中移除，其余键保持顺序前移
+static inline void hot_keys_take(const HotKeys* hk, int* counts, LineBatch* b) {
+    if (hk->size == 0) return;
+    int kept = 0;
+    for (int i = 0; i < b->size; i++) {
+        int k = hot_keys_find(hk, b->keys[i].ptr, b->keys[i].len, b->hashes[i]);
+        if (k >= 0) {
+            counts[k]++;
+            continue;
+        }
+        b->keys[kept] = b->keys[i];
+        b->hashes[kept] = b->hashes[i];
+        kept++;
+    }
+    b->size = kept;
+}
+
+// 把私有计数合并进表 m
+static inline void hot_keys_flush(const HotKeys* hk, const int* counts, HashMap* m) {
+    for (int k = 0; k < hk->size; k++) {
+        if (counts[k] > 0) hashmap_add_hashed(m, hk->keys[k], hk->lens[k], hk->hashes[k], counts[k]);
+    }
+}
+
+#endif
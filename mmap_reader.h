@@ -0,0 +1,217 @@
+#ifndef MMAP_READER_H
+#define MMAP_READER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hash_table.h"
+
+// 以 mmap 方式只读映射输入文件，按行切出键片段（指针 + 长度），
+// 键直接指向映射区域，不逐行拷贝，也不需要 '\0' 结尾。
+
+typedef struct {
+    const char* ptr;
+    size_t len;
+} KeySlice;
+
+typedef struct {
+    const char* data;
+    size_t size;
+} MappedFile;
+
+// 成功返回 0，失败返回 -1（errno 保留，可直接 perror）
+static inline int map_file(const char* path, MappedFile* mf) {
+    mf->data = NULL;
+    mf->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // 空文件无法映射，按零长度处理
+    if (st.st_size > 0) {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        mf->data = (const char*)p;
+        mf->size = st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+static inline void unmap_file(MappedFile* mf) {
+    if (mf->data) munmap((void*)mf->data, mf->size);
+    mf->data = NULL;
+    mf->size = 0;
+}
+
+// 返回不小于 pos 的第一个行首位置；跨过 pos 的那一行归前一个区间，
+// 因此用同一规则切出的相邻区间 [line_start_after(a), line_start_after(b)) 恰好不重不漏
+static inline size_t line_start_after(const MappedFile* mf, size_t pos) {
+    if (pos == 0) return 0;
+    if (pos >= mf->size) return mf->size;
+    const char* nl = simd_kernels.find_newline(mf->data + pos - 1, mf->data + mf->size);
+    return nl ? (size_t)(nl - mf->data) + 1 : mf->size;
+}
+
+typedef struct {
+    const char* cur;
+    const char* end;
+} LineReader;
+
+static inline void line_reader_init(LineReader* r, const char* begin, const char* end) {
+    r->cur = begin;
+    r->end = end;
+}
+
+// 取下一个键，读完返回 0。长度不小于 MAX_KEY_LEN 的行直接跳过；
+// 末尾没有换行符的最后一行照常返回。
+static inline int line_reader_next(LineReader* r, KeySlice* key) {
+    while (r->cur < r->end) {
+        const char* line = r->cur;
+        const char* nl = simd_kernels.find_newline(line, r->end);
+        const char* line_end = nl ? nl : r->end;
+        r->cur = nl ? nl + 1 : r->end;
+        if (line_end - line < MAX_KEY_LEN) {
+            key->ptr = line;
+            key->len = line_end - line;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 批量读取：一次切出最多 LINE_BATCH 个键并算好哈希。插入前先为整批键预取槽位，
+// 等到真正插入时槽位多半已在缓存中，大表上逐个插入时的 DRAM 延迟由此被掩盖。
+#define LINE_BATCH 256
+
+typedef struct {
+    KeySlice keys[LINE_BATCH];
+    unsigned int hashes[LINE_BATCH];
+    int size;
+} LineBatch;
+
+// 只切出下一批键、不计算 hashes，读完返回 0；规则与 line_reader_next 相同。
+// 供自己计算哈希的调用方（如 sketch.h）使用
+static inline int line_reader_split_batch(LineReader* r, LineBatch* b) {
+    const char* nls[LINE_BATCH];
+    b->size = 0;
+    while (b->size == 0 && r->cur < r->end) {
+        int found = simd_kernels.find_newlines(r->cur, r->end, nls, LINE_BATCH);
+        for (int i = 0; i < found; i++) {
+            const char* line = r->cur;
+            r->cur = nls[i] + 1;
+            if (nls[i] - line < MAX_KEY_LEN) {
+                b->keys[b->size].ptr = line;
+                b->keys[b->size].len = nls[i] - line;
+                b->size++;
+            }
+        }
+        // 没有找满说明后面已没有换行符，剩下的是末尾没有换行的最后一行
+        if (found < LINE_BATCH && r->cur < r->end) {
+            if (r->end - r->cur < MAX_KEY_LEN) {
+                b->keys[b->size].ptr = r->cur;
+                b->keys[b->size].len = r->end - r->cur;
+                b->size++;
+            }
+            r->cur = r->end;
+        }
+    }
+    return b->size;
+}
+
+// 取下一批键并算好哈希，读完返回 0
+static inline int line_reader_next_batch(LineReader* r, LineBatch* b) {
+    line_reader_split_batch(r, b);
+    for (int i = 0; i < b->size; i++) b->hashes[i] = hash_string(b->keys[i].ptr, b->keys[i].len);
+    return b->size;
+}
+
+// 分块流式解析映射区 [lo, hi)：每次取出约 MAP_STREAM_BLOCK 字节（结尾对齐到行首）交给 LineReader。
+// 取出一块时对下一块发出 MADV_WILLNEED，内核在后台读入，与这一块的解析重叠；
+// 解析过的整页用 MADV_DONTNEED 解除映射（键都已拷入哈希表，之后不再访问，
+// 再访问也只是重新从文件读入），进程驻留的输入页因此只有两块左右，而不是整个区间。
+#define MAP_STREAM_BLOCK (8 << 20)
+// 预取下一个文件时最多读入的字节数
+#define MAP_PREFETCH_BYTES (4 * MAP_STREAM_BLOCK)
+
+typedef struct {
+    const MappedFile* f;
+    size_t pos;
+    size_t hi;
+    size_t released;    // 此前的整页已解除映射
+} MapStream;
+
+static inline size_t map_page_floor(size_t pos) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return pos / page * page;
+}
+
+static inline void map_stream_init(MapStream* s, const MappedFile* f, size_t lo, size_t hi) {
+    s->f = f;
+    s->pos = lo;
+    s->hi = hi;
+    s->released = map_page_floor(lo);
+}
+
+// 把下一块交给 r，读完返回 0。调用时上一块须已解析完
+static inline int map_stream_next(MapStream* s, LineReader* r) {
+    size_t drop = map_page_floor(s->pos);
+    if (drop > s->released) {
+        madvise((void*)(s->f->data + s->released), drop - s->released, MADV_DONTNEED);
+        s->released = drop;
+    }
+    if (s->pos >= s->hi) return 0;
+
+    size_t end = s->hi;
+    if (s->hi - s->pos > MAP_STREAM_BLOCK) {
+        end = line_start_after(s->f, s->pos + MAP_STREAM_BLOCK);
+        if (end > s->hi) end = s->hi;
+    }
+    if (end < s->hi) {
+        size_t ahead = map_page_floor(end);
+        size_t len = s->hi - ahead < MAP_STREAM_BLOCK ? s->hi - ahead : MAP_STREAM_BLOCK;
+        madvise((void*)(s->f->data + ahead), len, MADV_WILLNEED);
+    }
+    line_reader_init(r, s->f->data + s->pos, s->f->data + end);
+    s->pos = end;
+    return 1;
+}
+
+// 让内核在后台把 path 按字节均分的第 part 份（共 parts 份）的开头读进页缓存，不等待完成。
+// 归并当前文件时对下一个文件调用，下一个文件开始解析时前几块已经在内存里
+static inline void prefetch_file(const char* path, int part, int parts) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        off_t lo = st.st_size / parts * part;
+        off_t len = part == parts - 1 ? st.st_size - lo : st.st_size / parts;
+        if (len > MAP_PREFETCH_BYTES) len = MAP_PREFETCH_BYTES;
+        posix_fadvise(fd, lo, len, POSIX_FADV_WILLNEED);
+    }
+    close(fd);
+}
+
+// 整批键各计一次：先预取全部槽位，再依次插入
+static inline void hashmap_add_batch(HashMap* m, const LineBatch* b) {
+    for (int i = 0; i < b->size; i++) hashmap_prefetch(m, b->hashes[i]);
+    for (int i = 0; i < b->size; i++) {
+        hashmap_add_hashed(m, b->keys[i].ptr, b->keys[i].len, b->hashes[i], 1);
+    }
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef OMP_TABLES_H
+#define OMP_TABLES_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "hash_table.h"
+#include "hot_keys.h"
+#include "mmap_reader.h"
+#include "stats.h"
+
+// 多线程计数：OpenMP 版本和混合 MPI+OpenMP 版本共用。
+// 每个线程的局部表按哈希高位切成 nt 个分片：locals[t * threads + p] 为线程 t 的第 p 片。
+// 合并时线程 p 只处理所有局部表的第 p 片，写入自己独占的 shards[p]，全程无需加锁。
+// 合并后各 shards[p] 的键互不相交（hash_shard(h, nt) == p）。
+// 这些表在各文件之间复用，用完清空而不释放。
+// hot_limit > 0 时计数前先抽样检测热点键（hot_keys.h），热点键由各线程计入私有计数，
+// 合并时由键所属分片的线程累加后写入 shards[p]。
+
+#define OMP_SHARD_CAPACITY (1 << 20)
+
+typedef struct {
+    int threads;
+    HashMap** locals;
+    HashMap** shards;
+    int hot_limit;          // 最多检测的热点键个数，0 表示不检测
+    HotKeys hot;
+    int* hot_counts;        // 线程 t 的私有计数在 hot_counts[t * HOT_KEYS_MAX ..] 处汇总
+} OmpTables;
+
+static inline void omp_tables_init(OmpTables* t, int threads, int hot_limit) {
+    t->threads = threads;
+    t->locals = (HashMap**)calloc((size_t)threads * threads, sizeof(HashMap*));
+    t->shards = (HashMap**)calloc(threads, sizeof(HashMap*));
+    t->hot_limit = hot_limit;
+    hot_keys_clear(&t->hot);
+    t->hot_counts = (int*)calloc((size_t)threads * HOT_KEYS_MAX, sizeof(int));
+}
+
+static inline void omp_tables_free(OmpTables* t) {
+    for (int i = 0; i < t->threads * t->threads; i++) {
+        if (t->locals[i]) destroy_hashmap(t->locals[i]);
+    }
+    for (int p = 0; p < t->threads; p++) {
+        if (t->shards[p]) destroy_hashmap(t->shards[p]);
+    }
+    free(t->locals);
+    free(t->shards);
+    free(t->hot_counts);
+}
+
+static inline void omp_tables_clear(OmpTables* t) {
+    for (int p = 0; p < t->threads; p++) {
+        if (t->shards[p]) hashmap_clear(t->shards[p]);
+    }
+}
+
+// 用 t->threads 个线程统计 f 中 [lo, hi) 的键（两端须为行首），结果在 shards[0..nt) 中，
+// 返回实际的线程数 nt。table_size 为合并后全部分片的总槽位数，0 表示默认；
+// t_count 返回解析计数结束、开始合并的时刻
+static inline int omp_count_range(OmpTables* t, const MappedFile* f, size_t lo, size_t hi,
+                                  unsigned int table_size, double* t_count) {
+    int threads = t->threads;
+    HashMap** locals = t->locals;
+    HashMap** shards = t->shards;
+    unsigned int shard_size = table_size ? table_size : OMP_SHARD_CAPACITY;
+    unsigned int local_size = shard_size / 4;
+    int used = 1;
+    HotKeys* hot = &t->hot;
+
+    STATS_TIMER(t_sample);
+    hot_keys_detect(hot, f, lo, hi, t->hot_limit);
+    STATS_ELAPSED(STAT_COUNT, t_sample);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        STATS_TIMER(t_local);
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int hot_local[HOT_KEYS_MAX] = {0};
+
+        // 按字节把区间均分给各线程，两端对齐到行首（与 group_by_mpi 的划分方式相同），
+        // 每个线程直接解析自己的区间并计入私有的局部表
+        size_t begin = line_start_after(f, lo + (hi - lo) / nt * tid);
+        size_t end = tid == nt - 1 ? hi : line_start_after(f, lo + (hi - lo) / nt * (tid + 1));
+
+        HashMap** mine = locals + (size_t)tid * threads;
+        for (int p = 0; p < nt; p++) {
+            if (!mine[p]) mine[p] = create_hashmap(local_size / nt);
+        }
+
+        // 每批键先按分片预取槽位再插入，见 mmap_reader.h 的 LineBatch；
+        // 区间按 MapStream 分块解析，读入与解析重叠
+        MapStream stream;
+        LineReader reader;
+        LineBatch batch;
+        map_stream_init(&stream, f, begin, end);
+        while (map_stream_next(&stream, &reader)) {
+            while (line_reader_next_batch(&reader, &batch)) {
+                hot_keys_take(hot, hot_local, &batch);
+                for (int k = 0; k < batch.size; k++) {
+                    unsigned int h = batch.hashes[k];
+                    hashmap_prefetch(mine[hash_shard(h, nt)], h);
+                }
+                for (int k = 0; k < batch.size; k++) {
+                    unsigned int h = batch.hashes[k];
+                    hashmap_add_hashed(mine[hash_shard(h, nt)], batch.keys[k].ptr, batch.keys[k].len, h, 1);
+                }
+            }
+        }
+
+        memcpy(t->hot_counts + (size_t)tid * HOT_KEYS_MAX, hot_local, sizeof(hot_local));
+
+        // 各线程在屏障前的耗时分别计入，可以看出字节划分是否均衡
+        STATS_ELAPSED(STAT_COUNT, t_local);
+        #pragma omp barrier
+        #pragma omp single
+        {
+            used = nt;
+            *t_count = omp_get_wtime();
+        }
+
+        // 合并时复用已算好的指纹
+        STATS_TIMER(t_shard);
+        if (!shards[tid]) shards[tid] = create_hashmap(shard_size / nt);
+        HashMap* shard = shards[tid];
+        for (int k = 0; k < nt; k++) {
+            HashMap* local = locals[(size_t)k * threads + tid];
+            for (unsigned int j = 0; j < local->capacity; j++) {
+                Slot* s = &local->slots[j];
+                if (s->key) hashmap_add_hashed(shard, s->key, strlen(s->key), s->hash, s->count);
+            }
+            hashmap_clear(local);
+        }
+        // 属于本分片的热点键：累加各线程的私有计数
+        for (int k = 0; k < hot->size; k++) {
+            if (hash_shard(hot->hashes[k], nt) != tid) continue;
+            int sum = 0;
+            for (int p = 0; p < nt; p++) sum += t->hot_counts[(size_t)p * HOT_KEYS_MAX + k];
+            if (sum > 0) hashmap_add_hashed(shard, hot->keys[k], hot->lens[k], hot->hashes[k], sum);
+        }
+        STATS_ELAPSED(STAT_MERGE, t_shard);
+    }
+    return used;
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// 三个版本共用的排序引擎。
+// 按次数排序：先对 count 做 LSD 基数排序（降序，稳定），再对次数相同的每一段
+// 按键做多关键字快速排序（multikey quicksort，按第 d 个字符三路划分的 MSD 排序）。
+// 按键排序：直接对整个数组做多关键字快速排序。
+// 键必须以 '\0' 结尾。
+
+#define RADIX_INSERTION_MIN 16
+#define RADIX_TASK_CUTOFF (1 << 14)
+#define RADIX_PARALLEL_MIN (1 << 16)
+
+typedef struct {
+    const char* key;
+    int count;
+    int tag;        // 调用方附带的编号，排序时不比较，随条目一起移动（占用原有的填充字节）
+} SortEntry;
+
+static inline int radix_key_char(const SortEntry* e, int d) {
+    return (unsigned char)e->key[d];
+}
+
+static inline void radix_swap(SortEntry* a, int i, int j) {
+    SortEntry t = a[i];
+    a[i] = a[j];
+    a[j] = t;
+}
+
+// 前 d 个字符已知相同，从第 d 个字符起插入排序
+static inline void radix_insertion_sort(SortEntry* a, int n, int d) {
+    for (int i = 1; i < n; i++) {
+        SortEntry cur = a[i];
+        int j = i;
+        while (j > 0 && strcmp(a[j - 1].key + d, cur.key + d) > 0) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = cur;
+    }
+}
+
+// 按第 d 个字符三路划分：[0, *lt) 小于枢轴，[*lt, *gt) 等于，[*gt, n) 大于；返回枢轴字符
+static inline int radix_partition(SortEntry* a, int n, int d, int* lt, int* gt) {
+    int c0 = radix_key_char(&a[0], d);
+    int c1 = radix_key_char(&a[n / 2], d);
+    int c2 = radix_key_char(&a[n - 1], d);
+    int v = c0 < c1 ? (c1 < c2 ? c1 : (c0 < c2 ? c2 : c0))
+                    : (c0 < c2 ? c0 : (c1 < c2 ? c2 : c1));
+
+    int l = 0, i = 0, g = n;
+    while (i < g) {
+        int c = radix_key_char(&a[i], d);
+        if (c < v) radix_swap(a, l++, i++);
+        else if (c > v) radix_swap(a, i, --g);
+        else i++;
+    }
+    *lt = l;
+    *gt = g;
+    return v;
+}
+
+static inline void multikey_qsort(SortEntry* a, int n, int d) {
+    while (n > RADIX_INSERTION_MIN) {
+        int lt, gt;
+        int v = radix_partition(a, n, d, &lt, &gt);
+        multikey_qsort(a, lt, d);
+        multikey_qsort(a + gt, n - gt, d);
+        // 等于枢轴的一段继续比较下一个字符；枢轴为 '\0' 说明这些键已完全相同
+        if (v == 0) return;
+        a += lt;
+        n = gt - lt;
+        d++;
+    }
+    radix_insertion_sort(a, n, d);
+}
+
+// count 降序的稳定 LSD 基数排序，每趟 8 位；高位全为 0 或全部落入同一桶的趟直接跳过
+static inline void radix_sort_counts(SortEntry* a, int n) {
+    unsigned int max = 0;
+    for (int i = 0; i < n; i++) max |= (unsigned int)a[i].count;
+
+    SortEntry* tmp = (SortEntry*)malloc(sizeof(SortEntry) * (n > 0 ? n : 1));
+    SortEntry* src = a;
+    SortEntry* dst = tmp;
+    for (int shift = 0; shift < 32 && (max >> shift); shift += 8) {
+        int hist[256] = {0};
+        for (int i = 0; i < n; i++) hist[255 - (((unsigned int)src[i].count >> shift) & 255)]++;
+        if (hist[255 - (((unsigned int)src[0].count >> shift) & 255)] == n) continue;
+
+        int sum = 0;
+        for (int b = 0; b < 256; b++) {
+            int c = hist[b];
+            hist[b] = sum;
+            sum += c;
+        }
+        for (int i = 0; i < n; i++) {
+            dst[hist[255 - (((unsigned int)src[i].count >> shift) & 255)]++] = src[i];
+        }
+        SortEntry* t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != a) memcpy(a, src, sizeof(SortEntry) * n);
+    free(tmp);
+}
+
+// 按 (次数降序, 键升序) 排序
+static inline void sort_by_count(SortEntry* a, int n) {
+    if (n < 2) return;
+    radix_sort_counts(a, n);
+    int i = 0;
+    while (i < n) {
+        int j = i + 1;
+        while (j < n && a[j].count == a[i].count) j++;
+        if (j - i > 1) multikey_qsort(a + i, j - i, 0);
+        i = j;
+    }
+}
+
+// 按键升序排序
+static inline void sort_by_key(SortEntry* a, int n) {
+    if (n < 2) return;
+    multikey_qsort(a, n, 0);
+}
+
+#ifdef _OPENMP
+static inline void multikey_qsort_task(SortEntry* a, int n, int d) {
+    if (n < RADIX_TASK_CUTOFF) {
+        multikey_qsort(a, n, d);
+        return;
+    }
+    int lt, gt;
+    int v = radix_partition(a, n, d, &lt, &gt);
+    #pragma omp task
+    multikey_qsort_task(a, lt, d);
+    #pragma omp task
+    multikey_qsort_task(a + gt, n - gt, d);
+    if (v != 0) multikey_qsort_task(a + lt, gt - lt, d + 1);
+    #pragma omp taskwait
+}
+
+// sort_by_key 的并行版本：多关键字快速排序的各个划分作为任务并行
+static inline void parallel_sort_by_key(SortEntry* a, int n) {
+    if (n < RADIX_PARALLEL_MIN) {
+        sort_by_key(a, n);
+        return;
+    }
+    #pragma omp parallel
+    #pragma omp single
+    multikey_qsort_task(a, n, 0);
+}
+
+// sort_by_count 的并行版本：基数排序每趟各线程先统计自己那一块的直方图，
+// 按 (桶, 线程) 顺序求前缀和后各自分发，保持稳定；次数相同的段再用任务并行排序。
+static inline void parallel_sort_by_count(SortEntry* a, int n) {
+    if (n < RADIX_PARALLEL_MIN) {
+        sort_by_count(a, n);
+        return;
+    }
+
+    unsigned int max = 0;
+    #pragma omp parallel for reduction(|:max)
+    for (int i = 0; i < n; i++) max |= (unsigned int)a[i].count;
+
+    int max_threads = omp_get_max_threads();
+    int* hist = (int*)malloc(sizeof(int) * 256 * max_threads);
+    SortEntry* tmp = (SortEntry*)malloc(sizeof(SortEntry) * n);
+    SortEntry* result = a;
+
+    #pragma omp parallel
+    {
+        int tid = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int lo = (int)((long long)n * tid / nt);
+        int hi = (int)((long long)n * (tid + 1) / nt);
+        int* h = hist + 256 * tid;
+        SortEntry* src = a;
+        SortEntry* dst = tmp;
+
+        for (int shift = 0; shift < 32 && (max >> shift); shift += 8) {
+            memset(h, 0, sizeof(int) * 256);
+            for (int i = lo; i < hi; i++) h[255 - (((unsigned int)src[i].count >> shift) & 255)]++;
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                int sum = 0;
+                for (int b = 0; b < 256; b++) {
+                    for (int t = 0; t < nt; t++) {
+                        int c = hist[256 * t + b];
+                        hist[256 * t + b] = sum;
+                        sum += c;
+                    }
+                }
+            }
+
+            for (int i = lo; i < hi; i++) {
+                dst[h[255 - (((unsigned int)src[i].count >> shift) & 255)]++] = src[i];
+            }
+            #pragma omp barrier
+
+            SortEntry* t = src;
+            src = dst;
+            dst = t;
+        }
+
+        #pragma omp single
+        result = src;
+    }
+
+    if (result != a) {
+        #pragma omp parallel for
+        for (int i = 0; i < n; i++) a[i] = result[i];
+    }
+    free(tmp);
+    free(hist);
+
+    // 相邻的次数段攒够 RADIX_TASK_CUTOFF 个条目才生成一个任务，避免大量小任务
+    #pragma omp parallel
+    #pragma omp single
+    {
+        int i = 0;
+        while (i < n) {
+            int begin = i;
+            while (i < n && i - begin < RADIX_TASK_CUTOFF) {
+                int j = i + 1;
+                while (j < n && a[j].count == a[i].count) j++;
+                i = j;
+            }
+            #pragma omp task firstprivate(begin, i)
+            {
+                int k = begin;
+                while (k < i) {
+                    int j = k + 1;
+                    while (j < i && a[j].count == a[k].count) j++;
+                    if (j - k > 1) multikey_qsort_task(a + k, j - k, 0);
+                    k = j;
+                }
+            }
+        }
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef RESULT_FILE_H
+#define RESULT_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "mmap_reader.h"
+#include "radix_sort.h"
+
+// 二进制结果格式（--format binary）：整个文件直接 mmap 使用，不必逐行解析文本。
+//   头部     ResultHeader，64 字节
+//   counts   int32[n]，按 (次数降序, 键升序) 排列，第 i 项是排名第 i 的键的次数
+//   offsets  uint32[n + 1]，排名第 i 的键位于 blob + offsets[i]，以 '\0' 结尾，
+//            长度为 offsets[i + 1] - offsets[i] - 1（与 entry_set.h 一样，键合计不超过 4GB）
+//   index    uint32[n]，按键升序排列的排名，查找一个键只需在其上二分
+//   blob     所有键首尾相接
+// 各段按 8 字节对齐，数值为本机字节序（头部带字节序标记，读取时核对）。
+// 前 N 名就是 counts/offsets 的前 N 项；原来的文本格式由 result_write_text 从它转换得到。
+
+#define RESULT_MAGIC "GBRESULT"
+#define RESULT_VERSION 1
+#define RESULT_BYTE_ORDER 0x01020304u
+#define RESULT_IO_BUFFER (1 << 20)
+// 文本输出每个线程至少分到的条目数，更少时不值得开并行区域
+#define RESULT_TEXT_SLICE_MIN (1 << 15)
+// 文本输出一行的上限：键、空格、最多 10 位数字、换行
+#define RESULT_TEXT_LINE_MAX (MAX_KEY_LEN + 12)
+
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int byte_order;
+    unsigned long long count;
+    unsigned long long counts_offset;
+    unsigned long long offsets_offset;
+    unsigned long long index_offset;
+    unsigned long long blob_offset;
+    unsigned long long blob_bytes;
+} ResultHeader;
+
+typedef struct {
+    MappedFile map;
+    unsigned long long count;
+    const int* counts;
+    const unsigned int* offsets;
+    const unsigned int* index;
+    const char* blob;
+} ResultFile;
+
+// 非负整数的十进制位数
+static inline int uint_digits(unsigned int v) {
+    return 1 + (v >= 10) + (v >= 100) + (v >= 1000) + (v >= 10000) + (v >= 100000) +
+           (v >= 1000000) + (v >= 10000000) + (v >= 100000000) + (v >= 1000000000);
+}
+
+// 把非负整数写成十进制，返回写入的字节数。先由位数定出结尾，再从低位起每次查表写两位
+static inline int format_uint(char* dst, unsigned int v) {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    int n = uint_digits(v);
+    char* p = dst + n;
+    while (v >= 100) {
+        unsigned int r = v % 100;
+        v /= 100;
+        p -= 2;
+        memcpy(p, pairs + 2 * r, 2);
+    }
+    if (v >= 10) memcpy(p - 2, pairs + 2 * v, 2);
+    else p[-1] = (char)('0' + v);
+    return n;
+}
+
+static inline unsigned long long result_align(unsigned long long pos) {
+    return (pos + 7) & ~7ULL;
+}
+
+static inline int result_pad(FILE* f, unsigned long long pos) {
+    static const char zeros[8] = {0};
+    size_t pad = result_align(pos) - pos;
+    return fwrite(zeros, 1, pad, f) == pad ? 0 : -1;
+}
+
+// 数值列经由一块 RESULT_IO_BUFFER 字节的暂存区成块写出，不为整列分配数组。
+// *used 为暂存区中已有的个数，写满时刷出；出错返回 -1
+#define RESULT_COLUMN_BLOCK (RESULT_IO_BUFFER / sizeof(unsigned int))
+
+static inline int result_column_put(FILE* f, unsigned int* block, size_t* used, unsigned int v) {
+    block[(*used)++] = v;
+    if (*used < RESULT_COLUMN_BLOCK) return 0;
+    size_t n = *used;
+    *used = 0;
+    return fwrite(block, sizeof(unsigned int), n, f) == n ? 0 : -1;
+}
+
+// 刷出暂存区剩下的部分，再补齐到 8 字节对齐；end 为这一列写完后的文件位置
+static inline int result_column_end(FILE* f, unsigned int* block, size_t* used, unsigned long long end) {
+    size_t n = *used;
+    *used = 0;
+    if (fwrite(block, sizeof(unsigned int), n, f) != n) return -1;
+    return result_pad(f, end);
+}
+
+// 把已按 (次数降序, 键升序) 排好的 n 个条目写成二进制结果。失败返回 -1（errno 保留；
+// 键合计超过 4GB 时为 EFBIG）。除了为键序索引排序的 n 个 SortEntry，内存占用是定长的
+static inline int result_write_binary(const char* path, const SortEntry* entries, int n) {
+    ResultHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RESULT_MAGIC, sizeof(h.magic));
+    h.version = RESULT_VERSION;
+    h.byte_order = RESULT_BYTE_ORDER;
+    h.count = n;
+
+    SortEntry* by_key = (SortEntry*)malloc(sizeof(SortEntry) * (n > 0 ? n : 1));
+    unsigned int* block = (unsigned int*)malloc(RESULT_IO_BUFFER);
+    if (!by_key || !block) {
+        free(by_key);
+        free(block);
+        errno = ENOMEM;
+        return -1;
+    }
+    unsigned long long blob_bytes = 0;
+    for (int i = 0; i < n; i++) {
+        blob_bytes += strlen(entries[i].key) + 1;
+        by_key[i].key = entries[i].key;
+        by_key[i].count = entries[i].count;
+        by_key[i].tag = i;
+    }
+    // 键各不相同，按键排序后的 tag 就是键序索引
+    sort_by_key(by_key, n);
+
+    h.counts_offset = result_align(sizeof(h));
+    h.offsets_offset = result_align(h.counts_offset + sizeof(int) * (unsigned long long)n);
+    h.index_offset = result_align(h.offsets_offset + sizeof(unsigned int) * (unsigned long long)(n + 1));
+    h.blob_offset = result_align(h.index_offset + sizeof(unsigned int) * (unsigned long long)n);
+    h.blob_bytes = blob_bytes;
+
+    int rc = -1;
+    FILE* f = NULL;
+    if (blob_bytes > 0xffffffffULL) errno = EFBIG;
+    else f = fopen(path, "wb");
+    if (f) {
+        setvbuf(f, NULL, _IOFBF, RESULT_IO_BUFFER);
+        size_t used = 0;
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && result_pad(f, sizeof(h)) == 0;
+        for (int i = 0; ok && i < n; i++) {
+            ok = result_column_put(f, block, &used, (unsigned int)entries[i].count) == 0;
+        }
+        ok = ok && result_column_end(f, block, &used, h.counts_offset + sizeof(int) * (unsigned long long)n) == 0;
+        unsigned int offset = 0;
+        ok = ok && result_column_put(f, block, &used, 0) == 0;
+        for (int i = 0; ok && i < n; i++) {
+            offset += (unsigned int)strlen(entries[i].key) + 1;
+            ok = result_column_put(f, block, &used, offset) == 0;
+        }
+        ok = ok && result_column_end(f, block, &used,
+                                     h.offsets_offset + sizeof(unsigned int) * (unsigned long long)(n + 1)) == 0;
+        for (int i = 0; ok && i < n; i++) {
+            ok = result_column_put(f, block, &used, (unsigned int)by_key[i].tag) == 0;
+        }
+        ok = ok && result_column_end(f, block, &used,
+                                     h.index_offset + sizeof(unsigned int) * (unsigned long long)n) == 0;
+        for (int i = 0; ok && i < n; i++) {
+            size_t len = strlen(entries[i].key) + 1;
+            ok = fwrite(entries[i].key, 1, len, f) == len;
+        }
+        if (fclose(f) == 0 && ok) rc = 0;
+    }
+    free(by_key);
+    free(block);
+    return rc;
+}
+
+// 把 n 字节全部写到 fd 的 offset 处，pwrite 写不满时接着写。失败返回 -1（errno 保留）
+static inline int result_pwrite_all(int fd, const char* buf, size_t n, off_t offset) {
+    while (n > 0) {
+        ssize_t w = pwrite(fd, buf, n, offset);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= (size_t)w;
+        offset += w;
+    }
+    return 0;
+}
+
+// 键散落在各哈希表的 Arena 中，按排名顺序访问时预取后面第 RESULT_KEY_PREFETCH 个键
+#define RESULT_KEY_PREFETCH 16
+
+// 文本结果的定长写块：一行行拼进 RESULT_IO_BUFFER 字节的缓冲区，攒满就 pwrite 到 offset 处
+// 并后移。出错后不再写，error 保留第一个错误的 errno
+typedef struct {
+    int fd;
+    char* buf;
+    size_t used;
+    off_t offset;
+    int error;
+} TextBlock;
+
+static inline void text_block_init(TextBlock* b, int fd, off_t offset) {
+    b->fd = fd;
+    b->buf = (char*)malloc(RESULT_IO_BUFFER);
+    b->used = 0;
+    b->offset = offset;
+    b->error = b->buf ? 0 : ENOMEM;
+}
+
+static inline void text_block_flush(TextBlock* b) {
+    if (!b->error && b->used > 0 && result_pwrite_all(b->fd, b->buf, b->used, b->offset) != 0) {
+        b->error = errno;
+    }
+    b->offset += b->used;
+    b->used = 0;
+}
+
+// 追加一行 "键 次数"
+static inline void text_block_line(TextBlock* b, const char* key, size_t len, int count) {
+    if (b->error) return;
+    if (b->used > RESULT_IO_BUFFER - RESULT_TEXT_LINE_MAX) text_block_flush(b);
+    char* p = b->buf + b->used;
+    memcpy(p, key, len);
+    p[len] = ' ';
+    size_t digits = format_uint(p + len + 1, (unsigned int)count);
+    p[len + 1 + digits] = '\n';
+    b->used += len + digits + 2;
+}
+
+// 刷出剩下的部分并释放缓冲区，返回 0 或第一个错误的 errno
+static inline int text_block_finish(TextBlock* b) {
+    text_block_flush(b);
+    free(b->buf);
+    b->buf = NULL;
+    return b->error;
+}
+
+// 把已排好的 n 个条目写成文本结果（首行为条数，其后每行 "键 次数"）。
+// 启用 OpenMP 时按当前的线程数把条目切成连续的几片：各线程先只算出自己那片的字节数，
+// 求前缀和得到各片在文件中的位置后，各自用一个 TextBlock 边格式化边 pwrite，不经过 stdio，
+// 每个线程只占一块定长缓冲区。失败返回 -1（errno 保留）
+static inline int result_write_entries_text(const char* path, const SortEntry* entries, int n) {
+    int parts = 1;
+#ifdef _OPENMP
+    parts = omp_get_max_threads();
+    if (parts > n / RESULT_TEXT_SLICE_MIN) parts = n / RESULT_TEXT_SLICE_MIN;
+    if (parts < 1) parts = 1;
+#endif
+    size_t* lens = (size_t*)calloc(parts + 1, sizeof(size_t));
+    if (!lens) {
+        errno = ENOMEM;
+        return -1;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(lens);
+        return -1;
+    }
+
+    char header[16];
+    int header_len = snprintf(header, sizeof(header), "%d\n", n);
+    int failed = result_pwrite_all(fd, header, header_len, 0) != 0 ? errno : 0;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(parts) if (parts > 1)
+#endif
+    {
+        // 已在并行区域内（如串行后端同时处理多个文件）时实际的线程数可能少于 parts
+        int p = 0, team = 1;
+#ifdef _OPENMP
+        p = omp_get_thread_num();
+        team = omp_get_num_threads();
+#endif
+        int lo = (int)((long long)n * p / team);
+        int hi = (int)((long long)n * (p + 1) / team);
+        size_t len = 0;
+        for (int i = lo; i < hi; i++) {
+            if (i + RESULT_KEY_PREFETCH < hi) __builtin_prefetch(entries[i + RESULT_KEY_PREFETCH].key);
+            len += strlen(entries[i].key) + uint_digits((unsigned int)entries[i].count) + 2;
+        }
+        lens[p + 1] = len;
+#ifdef _OPENMP
+        #pragma omp barrier
+#endif
+        size_t offset = header_len;
+        for (int q = 1; q <= p; q++) offset += lens[q];
+
+        TextBlock block;
+        text_block_init(&block, fd, (off_t)offset);
+        for (int i = lo; i < hi && !block.error; i++) {
+            if (i + RESULT_KEY_PREFETCH < hi) __builtin_prefetch(entries[i + RESULT_KEY_PREFETCH].key);
+            text_block_line(&block, entries[i].key, strlen(entries[i].key), entries[i].count);
+        }
+        int err = text_block_finish(&block);
+        if (err) {
+#ifdef _OPENMP
+            #pragma omp critical(result_write_error)
+#endif
+            failed = err;
+        }
+    }
+    free(lens);
+    if (close(fd) != 0 && !failed) failed = errno;
+    if (failed) {
+        errno = failed;
+        return -1;
+    }
+    return 0;
+}
+
+// 映射并校验二进制结果。打不开时返回 -1（errno 保留），不是二进制结果时返回 -2
+static inline int result_open(const char* path, ResultFile* r) {
+    if (map_file(path, &r->map) != 0) return -1;
+    const ResultHeader* h = (const ResultHeader*)r->map.data;
+    unsigned long long size = r->map.size;
+    bool ok = size >= sizeof(*h) && memcmp(h->magic, RESULT_MAGIC, sizeof(h->magic)) == 0 &&
+              h->version == RESULT_VERSION && h->byte_order == RESULT_BYTE_ORDER &&
+              h->count < (1ULL << 32) &&
+              // 各段起点先各自不超过文件大小、按 8 字节对齐，下面的加法就不会回绕
+              h->counts_offset <= size && h->offsets_offset <= size && h->index_offset <= size &&
+              h->blob_offset <= size && h->blob_bytes <= size &&
+              (h->counts_offset | h->offsets_offset | h->index_offset) % 8 == 0 &&
+              h->counts_offset + sizeof(int) * h->count <= size &&
+              h->offsets_offset + sizeof(unsigned int) * (h->count + 1) <= size &&
+              h->index_offset + sizeof(unsigned int) * h->count <= size &&
+              h->blob_offset + h->blob_bytes <= size;
+    if (ok) {
+        r->count = h->count;
+        r->counts = (const int*)(r->map.data + h->counts_offset);
+        r->offsets = (const unsigned int*)(r->map.data + h->offsets_offset);
+        r->index = (const unsigned int*)(r->map.data + h->index_offset);
+        r->blob = r->map.data + h->blob_offset;
+        ok = r->offsets[h->count] == h->blob_bytes &&
+             (h->count == 0 || r->blob[h->blob_bytes - 1] == '\0');
+    }
+    // result_key / result_find 不再检查下标：打开时核对一遍偏移严格递增（每个键至少有结尾的 '\0'）、
+    // 索引都指向有效的排名。结尾的 '\0' 已核对过，即使键中间被改坏，strcmp 也不会读出字符串区
+    for (unsigned long long i = 0; ok && i < h->count; i++) {
+        ok = r->offsets[i] < r->offsets[i + 1] && r->index[i] < h->count;
+    }
+    if (!ok) {
+        unmap_file(&r->map);
+        return -2;
+    }
+    return 0;
+}
+
+static inline void result_close(ResultFile* r) {
+    unmap_file(&r->map);
+}
+
+// 排名第 i（从 0 起）的键
+static inline const char* result_key(const ResultFile* r, unsigned long long i) {
+    return r->blob + r->offsets[i];
+}
+
+// 在键序索引上二分，返回 key 的排名，不存在时返回 -1
+static inline long long result_find(const ResultFile* r, const char* key) {
+    unsigned long long lo = 0, hi = r->count;
+    while (lo < hi) {
+        unsigned long long mid = lo + (hi - lo) / 2;
+        int c = strcmp(result_key(r, r->index[mid]), key);
+        if (c == 0) return r->index[mid];
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+// 转成文本格式（首行为条数，其后每行 "键 次数"），limit > 0 时只写前 limit 名。
+// 失败返回 -1（errno 保留）
+static inline int result_write_text(const ResultFile* r, const char* path, unsigned long long limit) {
+    FILE* out = fopen(path, "w");
+    if (!out) return -1;
+    setvbuf(out, NULL, _IOFBF, RESULT_IO_BUFFER);
+    unsigned long long n = limit > 0 && limit < r->count ? limit : r->count;
+    fprintf(out, "%llu\n", n);
+    for (unsigned long long i = 0; i < n; i++) {
+        fprintf(out, "%s %d\n", result_key(r, i), r->counts[i]);
+    }
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "result_file.h"
+
+// 二进制结果文件（--format binary，格式见 result_file.h）的查看与转换，
+// 映射后直接读取，不解析整份结果。
+// 编译: g++ -O2 result_tool.cpp -o result_tool
+// 用法: ./result_tool 结果 --text 输出      转成与文本输出相同的格式
+//       ./result_tool 结果 --top N          打印前 N 名
+//       ./result_tool 结果 --get 键 [键...] 打印各键的次数和排名（不存在时次数为 0，排名为 -）
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s RESULT --text OUT | --top N | --get KEY [KEY...]\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    ResultFile r;
+    int opened = result_open(argv[1], &r);
+    if (opened != 0) {
+        if (opened == -2) fprintf(stderr, "Not a binary result file: %s\n", argv[1]);
+        else perror("Cannot open result file");
+        return 1;
+    }
+
+    int rc = 0;
+    if (strcmp(argv[2], "--text") == 0 && argc == 4) {
+        if (result_write_text(&r, argv[3], 0) != 0) {
+            perror("Cannot write text output");
+            rc = 1;
+        }
+    } else if (strcmp(argv[2], "--top") == 0 && argc == 4) {
+        unsigned long long n = strtoull(argv[3], NULL, 10);
+        if (n > r.count) n = r.count;
+        for (unsigned long long i = 0; i < n; i++) {
+            printf("%s %d\n", result_key(&r, i), r.counts[i]);
+        }
+    } else if (strcmp(argv[2], "--get") == 0) {
+        for (int i = 3; i < argc; i++) {
+            long long rank = result_find(&r, argv[i]);
+            if (rank >= 0) printf("%s %d %lld\n", argv[i], r.counts[rank], rank + 1);
+            else printf("%s 0 -\n", argv[i]);
+        }
+    } else {
+        usage(argv[0]);
+        rc = 1;
+    }
+    result_close(&r);
+    return rc;
+}
@@ -0,0 +1,295 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// 键哈希、键比较和换行扫描的 SIMD 内核，运行时按 CPU 选择级别：标量 / SSE4.2 / AVX2。
+// 各级别的函数用 target 属性单独编译，不需要 -msse4.2、-mavx2 等编译选项；
+// 环境变量 GROUPBY_SIMD=scalar|sse42|avx2 可以强制降级，便于对比。
+// 哈希按 8 字节一组做 CRC32C，标量版本用查表实现同一个 CRC，各级别的结果完全一致，
+// 因此不同 CPU 上的进程按哈希分发键时不会错位。
+// 向量读取可能越过键尾，只在不跨页时进行（同一页内多读几个字节不会出错），否则退回标量。
+
+enum { SIMD_SCALAR = 0, SIMD_SSE42 = 1, SIMD_AVX2 = 2 };
+
+typedef struct {
+    int level;
+    const char* name;
+    unsigned int (*hash)(const char* key, size_t len);
+    int (*equal)(const char* a, const char* b, size_t len);         // 前 len 个字节相同返回 1
+    const char* (*find_newline)(const char* p, const char* end);    // 找不到返回 NULL
+    // 依次找出 [p, end) 中最多 max 个换行符的位置写入 out，返回个数
+    int (*find_newlines)(const char* p, const char* end, const char** out, int max);
+} SimdKernels;
+
+// 标量 CRC32C 用 slicing-by-8 查表，每 8 字节查 8 次表
+static unsigned int simd_crc_table[8][256];
+
+static inline void simd_crc_init() {
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82f63b78U & (0U - (c & 1)));
+        simd_crc_table[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = simd_crc_table[t - 1][i];
+            simd_crc_table[t][i] = (c >> 8) ^ simd_crc_table[0][c & 0xff];
+        }
+    }
+}
+
+// 与 SSE4.2 的 crc32 指令相同：CRC32C，反射多项式，无初值和结尾取反
+static inline unsigned int simd_crc32c_u64(unsigned int crc, uint64_t w) {
+    unsigned int lo = crc ^ (unsigned int)w;
+    unsigned int hi = (unsigned int)(w >> 32);
+    return simd_crc_table[7][lo & 0xff] ^ simd_crc_table[6][(lo >> 8) & 0xff] ^
+           simd_crc_table[5][(lo >> 16) & 0xff] ^ simd_crc_table[4][lo >> 24] ^
+           simd_crc_table[3][hi & 0xff] ^ simd_crc_table[2][(hi >> 8) & 0xff] ^
+           simd_crc_table[1][(hi >> 16) & 0xff] ^ simd_crc_table[0][hi >> 24];
+}
+
+// CRC 是线性的，高位分布不够好，最后用 fmix32 打散
+static inline unsigned int simd_fmix32(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+// 从 p 起读 bytes 个字节不会跨到下一页
+static inline int simd_page_safe(const void* p, size_t bytes) {
+    return ((uintptr_t)p & 4095) <= 4096 - bytes;
+}
+
+static inline unsigned int simd_hash_scalar(const char* key, size_t len) {
+    unsigned int crc = (unsigned int)len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, key + i, 8);
+        crc = simd_crc32c_u64(crc, w);
+    }
+    if (i < len) {
+        uint64_t w = 0;
+        memcpy(&w, key + i, len - i);
+        crc = simd_crc32c_u64(crc, w);
+    }
+    return simd_fmix32(crc);
+}
+
+static inline int simd_equal_scalar(const char* a, const char* b, size_t len) {
+    return memcmp(a, b, len) == 0;
+}
+
+static inline const char* simd_find_newline_scalar(const char* p, const char* end) {
+    if (p >= end) return NULL;
+    return (const char*)memchr(p, '\n', end - p);
+}
+
+static inline int simd_find_newlines_scalar(const char* p, const char* end, const char** out, int max) {
+    int n = 0;
+    while (n < max && p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (!nl) break;
+        out[n++] = nl;
+        p = nl + 1;
+    }
+    return n;
+}
+
+#ifdef SIMD_X86
+__attribute__((target("sse4.2")))
+static inline unsigned int simd_hash_sse42(const char* key, size_t len) {
+    unsigned int crc = (unsigned int)len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, key + i, 8);
+        crc = (unsigned int)_mm_crc32_u64(crc, w);
+    }
+    if (i < len) {
+        // 尾部不足 8 字节：能整块读就读 8 字节再屏蔽多余的高位
+        size_t rest = len - i;
+        uint64_t w = 0;
+        if (simd_page_safe(key + i, 8)) {
+            memcpy(&w, key + i, 8);
+            w &= ~0ULL >> (64 - 8 * rest);
+        } else {
+            memcpy(&w, key + i, rest);
+        }
+        crc = (unsigned int)_mm_crc32_u64(crc, w);
+    }
+    return simd_fmix32(crc);
+}
+
+__attribute__((target("sse4.2")))
+static inline int simd_equal_sse42(const char* a, const char* b, size_t len) {
+    if (len <= 16 && simd_page_safe(a, 16) && simd_page_safe(b, 16)) {
+        __m128i x = _mm_loadu_si128((const __m128i*)a);
+        __m128i y = _mm_loadu_si128((const __m128i*)b);
+        unsigned int diff = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+        return (diff & ((1U << len) - 1)) == 0;
+    }
+    if (len <= 32 && simd_page_safe(a, 32) && simd_page_safe(b, 32)) {
+        __m128i x0 = _mm_loadu_si128((const __m128i*)a);
+        __m128i y0 = _mm_loadu_si128((const __m128i*)b);
+        __m128i x1 = _mm_loadu_si128((const __m128i*)(a + 16));
+        __m128i y1 = _mm_loadu_si128((const __m128i*)(b + 16));
+        unsigned int eq = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x0, y0)) |
+                          ((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x1, y1)) << 16);
+        unsigned int mask = len == 32 ? ~0U : (1U << len) - 1;
+        return (~eq & mask) == 0;
+    }
+    return memcmp(a, b, len) == 0;
+}
+
+// 按 16 字节对齐的块扫描，对齐的读取不会跨页；第一块中 p 之前的位屏蔽掉
+__attribute__((target("sse4.2")))
+static inline const char* simd_find_newline_sse42(const char* p, const char* end) {
+    if (p >= end) return NULL;
+    const __m128i nl = _mm_set1_epi8('\n');
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+    unsigned int m = (unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), nl));
+    m &= ~0U << (p - block);
+    while (1) {
+        if (m) {
+            const char* r = block + __builtin_ctz(m);
+            return r < end ? r : NULL;
+        }
+        block += 16;
+        if (block >= end) return NULL;
+        m = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), nl));
+    }
+}
+
+// 一次比较得到整块的换行掩码，逐位取出，短行时一次读取可切出多行
+__attribute__((target("sse4.2")))
+static inline int simd_find_newlines_sse42(const char* p, const char* end, const char** out, int max) {
+    if (p >= end || max <= 0) return 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+    unsigned int m = (unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), nl));
+    m &= ~0U << (p - block);
+    int n = 0;
+    while (1) {
+        while (m) {
+            const char* r = block + __builtin_ctz(m);
+            if (r >= end) return n;
+            out[n++] = r;
+            if (n == max) return n;
+            m &= m - 1;
+        }
+        block += 16;
+        if (block >= end) return n;
+        m = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)block), nl));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline int simd_equal_avx2(const char* a, const char* b, size_t len) {
+    if (len <= 32 && simd_page_safe(a, 32) && simd_page_safe(b, 32)) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)a);
+        __m256i y = _mm256_loadu_si256((const __m256i*)b);
+        unsigned int eq = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        unsigned int mask = len == 32 ? ~0U : (1U << len) - 1;
+        return (~eq & mask) == 0;
+    }
+    return memcmp(a, b, len) == 0;
+}
+
+__attribute__((target("avx2")))
+static inline const char* simd_find_newline_avx2(const char* p, const char* end) {
+    if (p >= end) return NULL;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+    unsigned int m = (unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), nl));
+    m &= ~0U << (p - block);
+    while (1) {
+        if (m) {
+            const char* r = block + __builtin_ctz(m);
+            return r < end ? r : NULL;
+        }
+        block += 32;
+        if (block >= end) return NULL;
+        m = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), nl));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline int simd_find_newlines_avx2(const char* p, const char* end, const char** out, int max) {
+    if (p >= end || max <= 0) return 0;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+    unsigned int m = (unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), nl));
+    m &= ~0U << (p - block);
+    int n = 0;
+    while (1) {
+        while (m) {
+            const char* r = block + __builtin_ctz(m);
+            if (r >= end) return n;
+            out[n++] = r;
+            if (n == max) return n;
+            m &= m - 1;
+        }
+        block += 32;
+        if (block >= end) return n;
+        m = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i*)block), nl));
+    }
+}
+#endif
+
+// 返回不高于 max_level 且 CPU 支持的最高级别的内核
+static inline SimdKernels simd_select(int max_level) {
+    simd_crc_init();
+    SimdKernels k = {SIMD_SCALAR, "scalar", simd_hash_scalar, simd_equal_scalar,
+                     simd_find_newline_scalar, simd_find_newlines_scalar};
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (max_level >= SIMD_SSE42 && __builtin_cpu_supports("sse4.2")) {
+        k.level = SIMD_SSE42;
+        k.name = "sse4.2";
+        k.hash = simd_hash_sse42;
+        k.equal = simd_equal_sse42;
+        k.find_newline = simd_find_newline_sse42;
+        k.find_newlines = simd_find_newlines_sse42;
+    }
+    // AVX2 没有更快的 CRC 指令，哈希沿用 SSE4.2 版本
+    if (max_level >= SIMD_AVX2 && k.level == SIMD_SSE42 && __builtin_cpu_supports("avx2")) {
+        k.level = SIMD_AVX2;
+        k.name = "avx2";
+        k.equal = simd_equal_avx2;
+        k.find_newline = simd_find_newline_avx2;
+        k.find_newlines = simd_find_newlines_avx2;
+    }
+#endif
+    return k;
+}
+
+static inline SimdKernels simd_detect() {
+    int level = SIMD_AVX2;
+    const char* env = getenv("GROUPBY_SIMD");
+    if (env) {
+        if (strcmp(env, "scalar") == 0) level = SIMD_SCALAR;
+        else if (strcmp(env, "sse42") == 0) level = SIMD_SSE42;
+    }
+    return simd_select(level);
+}
+
+// 程序启动时选定，之后只读
+static const SimdKernels simd_kernels = simd_detect();
+
+#endif
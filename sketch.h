@@ -0,0 +1,366 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "hash_table.h"
+#include "mmap_reader.h"
+#include "top_k.h"
+
+// 近似模式（--approx）：内存与输入大小无关，只回答"大约有多少个不同的键"和
+// "出现最多的若干个键大约出现了多少次"。每个线程一份 Sketch：
+//   HyperLogLog  2^p 个 1 字节寄存器，相对标准误差约 1.04 / sqrt(2^p)（--hll-error）；
+//   Count-Min    depth × width 个计数器，width = ceil(e / ε)，depth = ceil(ln(1 / δ))，
+//                估计值不小于真实次数，且以 1 - δ 的概率不超过真实次数 + ε·N（--cm-epsilon/--cm-delta）；
+//   Space-Saving capacity 个候选键（小根堆 + 开放定址索引），全局占比超过 1/capacity 的键
+//                至少会留在某一个线程/进程的候选中。
+// 合并：寄存器取最大值、Count-Min 逐项相加（MPI 上就是对定长缓冲区的 MPI_MAX / MPI_SUM 归约），
+// 各处的候选键取并集后用合并后的 Count-Min 重新估计次数，再选出前 heavy 个。
+
+#define SKETCH_MIN_CANDIDATES 256
+#define SKETCH_DEFAULT_HEAVY 100
+
+typedef struct {
+    double hll_error;       // HyperLogLog 的目标相对标准误差
+    double cm_epsilon;      // Count-Min 的误差上限，占总行数的比例
+    double cm_delta;        // 超出误差上限的概率
+    int heavy;              // 输出的高频键个数
+} SketchParams;
+
+typedef struct {
+    char key[MAX_KEY_LEN];
+    unsigned int len;
+    unsigned int count;
+    unsigned long long hash;
+    unsigned int slot;      // 在索引中的位置
+} SketchCounter;
+
+typedef struct {
+    int precision;
+    unsigned char* registers;
+    int width;
+    int depth;
+    unsigned int* cm;
+    int capacity;
+    int size;
+    SketchCounter* counters;    // 按 count 的小根堆
+    unsigned int* index;        // 堆下标 + 1，0 为空
+    unsigned int index_mask;
+    unsigned long long lines;
+} Sketch;
+
+// 64 位哈希（MurmurHash64A 的结构），HyperLogLog 在上千万个不同键上需要 64 位才不会饱和
+static inline unsigned long long sketch_hash(const char* key, size_t len) {
+    const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    unsigned long long h = 0x9e3779b97f4a7c15ULL ^ (len * m);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        unsigned long long k;
+        memcpy(&k, key + i, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < len) {
+        unsigned long long k = 0;
+        memcpy(&k, key + i, len - i);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+// 由命令行参数得到 Sketch 参数；未给 --top-k 时输出前 SKETCH_DEFAULT_HEAVY 个高频键
+static inline SketchParams sketch_params(double hll_error, double cm_epsilon, double cm_delta, int top_k) {
+    SketchParams p;
+    p.hll_error = hll_error;
+    p.cm_epsilon = cm_epsilon;
+    p.cm_delta = cm_delta;
+    p.heavy = top_k > 0 ? top_k : SKETCH_DEFAULT_HEAVY;
+    return p;
+}
+
+static inline void sketch_init(Sketch* s, const SketchParams* p) {
+    int precision = (int)ceil(log2((1.04 / p->hll_error) * (1.04 / p->hll_error)));
+    if (precision < 4) precision = 4;
+    if (precision > 18) precision = 18;
+    s->precision = precision;
+    s->registers = (unsigned char*)calloc((size_t)1 << precision, 1);
+
+    s->width = (int)ceil(exp(1.0) / p->cm_epsilon);
+    s->depth = (int)ceil(log(1.0 / p->cm_delta));
+    if (s->depth < 1) s->depth = 1;
+    s->cm = (unsigned int*)calloc((size_t)s->width * s->depth, sizeof(unsigned int));
+
+    s->capacity = p->heavy * 4 > SKETCH_MIN_CANDIDATES ? p->heavy * 4 : SKETCH_MIN_CANDIDATES;
+    s->size = 0;
+    s->counters = (SketchCounter*)malloc(sizeof(SketchCounter) * s->capacity);
+    unsigned int slots = 16;
+    while (slots < (unsigned int)s->capacity * 2) slots <<= 1;
+    s->index = (unsigned int*)calloc(slots, sizeof(unsigned int));
+    s->index_mask = slots - 1;
+    s->lines = 0;
+    if (!s->registers || !s->cm || !s->counters || !s->index) {
+        fprintf(stderr, "Sketch alloc failed\n");
+        exit(1);
+    }
+}
+
+static inline void sketch_free(Sketch* s) {
+    free(s->registers);
+    free(s->cm);
+    free(s->counters);
+    free(s->index);
+}
+
+static inline void sketch_clear(Sketch* s) {
+    memset(s->registers, 0, (size_t)1 << s->precision);
+    memset(s->cm, 0, sizeof(unsigned int) * s->width * s->depth);
+    memset(s->index, 0, sizeof(unsigned int) * (s->index_mask + 1));
+    s->size = 0;
+    s->lines = 0;
+}
+
+// Count-Min 第 row 行的列：双重哈希 h1 + row·h2，再映射到 [0, width)
+static inline unsigned int sketch_column(const Sketch* s, unsigned long long h, int row) {
+    unsigned int x = (unsigned int)h + (unsigned int)row * ((unsigned int)(h >> 32) | 1);
+    return (unsigned int)(((unsigned long long)x * (unsigned int)s->width) >> 32);
+}
+
+static inline unsigned int sketch_estimate(const Sketch* s, unsigned long long h) {
+    unsigned int best = 0xffffffffu;
+    for (int row = 0; row < s->depth; row++) {
+        unsigned int v = s->cm[(size_t)row * s->width + sketch_column(s, h, row)];
+        if (v < best) best = v;
+    }
+    return best;
+}
+
+static inline void sketch_heap_swap(Sketch* s, int a, int b) {
+    SketchCounter t = s->counters[a];
+    s->counters[a] = s->counters[b];
+    s->counters[b] = t;
+    s->index[s->counters[a].slot] = a + 1;
+    s->index[s->counters[b].slot] = b + 1;
+}
+
+static inline void sketch_sift_down(Sketch* s, int i) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < s->size && s->counters[l].count < s->counters[m].count) m = l;
+        if (r < s->size && s->counters[r].count < s->counters[m].count) m = r;
+        if (m == i) return;
+        sketch_heap_swap(s, i, m);
+        i = m;
+    }
+}
+
+static inline void sketch_sift_up(Sketch* s, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (s->counters[parent].count <= s->counters[i].count) return;
+        sketch_heap_swap(s, i, parent);
+        i = parent;
+    }
+}
+
+// 从索引中删除 slot，后续同一探测链上的项前移（线性探测的回移删除）
+static inline void sketch_index_delete(Sketch* s, unsigned int slot) {
+    unsigned int mask = s->index_mask;
+    unsigned int i = slot;
+    unsigned int j = slot;
+    while (1) {
+        j = (j + 1) & mask;
+        if (!s->index[j]) break;
+        unsigned int home = (unsigned int)s->counters[s->index[j] - 1].hash & mask;
+        // home 不在 (i, j] 之间的项可以移到 i
+        bool between = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (between) continue;
+        s->index[i] = s->index[j];
+        s->counters[s->index[i] - 1].slot = i;
+        i = j;
+    }
+    s->index[i] = 0;
+}
+
+static inline void sketch_add(Sketch* s, const char* key, size_t len) {
+    unsigned long long h = sketch_hash(key, len);
+    s->lines++;
+
+    unsigned int reg = (unsigned int)(h >> (64 - s->precision));
+    unsigned long long w = (h << s->precision) | (1ULL << (s->precision - 1));
+    unsigned char rank = (unsigned char)(__builtin_clzll(w) + 1);
+    if (rank > s->registers[reg]) s->registers[reg] = rank;
+
+    for (int row = 0; row < s->depth; row++) {
+        s->cm[(size_t)row * s->width + sketch_column(s, h, row)]++;
+    }
+
+    unsigned int slot = (unsigned int)h & s->index_mask;
+    while (s->index[slot]) {
+        int i = s->index[slot] - 1;
+        SketchCounter* c = &s->counters[i];
+        if (c->hash == h && c->len == len && memcmp(c->key, key, len) == 0) {
+            c->count++;
+            sketch_sift_down(s, i);
+            return;
+        }
+        slot = (slot + 1) & s->index_mask;
+    }
+
+    int i;
+    unsigned int count = 1;
+    if (s->size < s->capacity) {
+        i = s->size++;
+    } else {
+        // 替换计数最小的候选，新键继承它的计数
+        i = 0;
+        count = s->counters[0].count + 1;
+        sketch_index_delete(s, s->counters[0].slot);
+        slot = (unsigned int)h & s->index_mask;
+        while (s->index[slot]) slot = (slot + 1) & s->index_mask;
+    }
+    SketchCounter* c = &s->counters[i];
+    memcpy(c->key, key, len);
+    c->key[len] = '\0';
+    c->len = (unsigned int)len;
+    c->count = count;
+    c->hash = h;
+    c->slot = slot;
+    s->index[slot] = i + 1;
+    if (i == 0 && s->size == s->capacity) sketch_sift_down(s, 0);
+    else sketch_sift_up(s, i);
+}
+
+// 把 src 的寄存器和 Count-Min 合并进 dst（两者参数须相同），候选键另行合并
+static inline void sketch_merge(Sketch* dst, const Sketch* src) {
+    size_t regs = (size_t)1 << dst->precision;
+    for (size_t i = 0; i < regs; i++) {
+        if (src->registers[i] > dst->registers[i]) dst->registers[i] = src->registers[i];
+    }
+    size_t cells = (size_t)dst->width * dst->depth;
+    for (size_t i = 0; i < cells; i++) dst->cm[i] += src->cm[i];
+    dst->lines += src->lines;
+}
+
+// HyperLogLog 估计；估计值较小且有空寄存器时改用线性计数
+static inline double sketch_distinct(const Sketch* s) {
+    int m = 1 << s->precision;
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < m; i++) {
+        sum += ldexp(1.0, -s->registers[i]);
+        if (s->registers[i] == 0) zeros++;
+    }
+    double alpha = m >= 128 ? 0.7213 / (1 + 1.079 / m) : m >= 64 ? 0.709 : m >= 32 ? 0.697 : 0.673;
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) e = m * log((double)m / zeros);
+    return e;
+}
+
+// 把候选键 key 加入去重表 candidates
+static inline void sketch_add_candidate(HashMap* candidates, const char* key, size_t len) {
+    hashmap_add(candidates, key, len, 0);
+}
+
+// 候选键用合并后的 Count-Min 重新估计次数，选出前 heavy 个放入 top
+static inline void sketch_select(const Sketch* merged, HashMap* candidates, int heavy, TopK* top) {
+    topk_init(top, heavy);
+    for (unsigned int i = 0; i < candidates->capacity; i++) {
+        const Slot* c = &candidates->slots[i];
+        if (!c->key) continue;
+        unsigned int est = sketch_estimate(merged, sketch_hash(c->key, strlen(c->key)));
+        topk_offer(top, c->key, (int)est);
+    }
+    topk_finish(top);
+}
+
+// 首行为不同键数的估计值，其后为高频键及其估计次数（按次数降序、键升序）
+static inline void sketch_write(const char* output_file, double distinct, const TopK* top) {
+    FILE* out = fopen(output_file, "w");
+    if (!out) {
+        perror("Cannot open output file");
+        exit(1);
+    }
+    fprintf(out, "%.0f\n", distinct);
+    for (int i = 0; i < top->size; i++) {
+        fprintf(out, "%s %d\n", top->data[i].key, top->data[i].count);
+    }
+    fclose(out);
+}
+
+// 用 n 份 Sketch 统计 f 的 [lo, hi)：区间按字节均分给 n 个线程（未启用 OpenMP 时 n 须为 1），
+// 结束后寄存器和 Count-Min 合并在 sketches[0] 中，各线程的候选键并入 candidates
+static inline void sketch_count_range(Sketch* sketches, int n, const MappedFile* f,
+                                      size_t lo, size_t hi, HashMap* candidates) {
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(n) schedule(static, 1) if (n > 1)
+#endif
+    for (int t = 0; t < n; t++) {
+        size_t begin = line_start_after(f, lo + (hi - lo) / n * t);
+        size_t end = t == n - 1 ? hi : line_start_after(f, lo + (hi - lo) / n * (t + 1));
+        // 按 MapStream 分块解析，驻留的输入页与 Sketch 一样不随文件大小增长；
+        // sketch_add 自己用 sketch_hash 计算 64 位哈希，切分时不再另算一次
+        MapStream stream;
+        LineReader reader;
+        LineBatch batch;
+        map_stream_init(&stream, f, begin, end);
+        while (map_stream_next(&stream, &reader)) {
+            while (line_reader_split_batch(&reader, &batch)) {
+                for (int k = 0; k < batch.size; k++) sketch_add(&sketches[t], batch.keys[k].ptr, batch.keys[k].len);
+            }
+        }
+    }
+    for (int t = 0; t < n; t++) {
+        if (t > 0) sketch_merge(&sketches[0], &sketches[t]);
+        for (int i = 0; i < sketches[t].size; i++) {
+            const SketchCounter* c = &sketches[t].counters[i];
+            sketch_add_candidate(candidates, c->key, c->len);
+        }
+    }
+}
+
+// 单进程的近似模式（串行与 OpenMP 后端）：sketches 为 n 份已初始化的 Sketch，用完清空
+static inline int sketch_process_file(Sketch* sketches, int n, const SketchParams* p,
+                                      const char* input_file, const char* output_file) {
+    MappedFile f;
+    if (map_file(input_file, &f) != 0) {
+        fprintf(stderr, "Cannot open %s\n", input_file);
+        return -1;
+    }
+    HashMap* candidates = create_hashmap(sketches[0].capacity * 2 * n);
+    sketch_count_range(sketches, n, &f, 0, f.size, candidates);
+    unmap_file(&f);
+
+    TopK top;
+    sketch_select(&sketches[0], candidates, p->heavy, &top);
+    sketch_write(output_file, sketch_distinct(&sketches[0]), &top);
+    topk_free(&top);
+    destroy_hashmap(candidates);
+    for (int t = 0; t < n; t++) sketch_clear(&sketches[t]);
+    return 0;
+}
+
+static inline void sketch_params_report(const SketchParams* p) {
+    Sketch s;
+    sketch_init(&s, p);
+    printf("Approximate mode: HLL 2^%d registers (std error %.2f%%), Count-Min %d x %d "
+           "(count + %.4g%% of lines with prob %.4g), %d candidates, %d heavy hitters\n",
+           s.precision, 104.0 / sqrt((double)(1 << s.precision)), s.depth, s.width,
+           p->cm_epsilon * 100, 1 - p->cm_delta, s.capacity, p->heavy);
+    sketch_free(&s);
+}
+
+#endif
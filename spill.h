@@ -0,0 +1,267 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hash_table.h"
+#include "radix_sort.h"
+#include "result_file.h"
+
+// 外存分组：哈希表超过内存预算时，把其中的 (键, 次数) 按键排序后写成一个有序段
+// 到临时文件，然后清空表继续计数。输入读完后：
+//   1. 多路归并所有按键有序的段，相同的键累加次数（与 merge_same_keys 的做法相同），
+//      得到不重复的 (键, 次数) 流；
+//   2. 这个流按预算分批，按 (次数降序, 键升序) 排好后再写成若干有序段；
+//   3. 多路归并这些段，直接写出最终结果。
+// 任何时刻内存中只有一个预算大小的批次和每个段的一条当前记录。
+// 临时文件创建后立即 unlink，进程退出时由系统回收。
+// 段内记录格式：1 字节键长 + 键 + int 次数。
+
+#define SPILL_IO_BUFFER (1 << 20)
+
+typedef struct {
+    char key[MAX_KEY_LEN];
+    int count;
+} SpillRecord;
+
+typedef struct {
+    FILE* f;
+    SpillRecord rec;
+} RunReader;
+
+typedef struct {
+    const char* dir;
+    size_t budget;
+    FILE** runs;
+    int run_count;
+    int run_capacity;
+} SpillSet;
+
+static inline void spill_init(SpillSet* sp, const char* dir, size_t budget) {
+    sp->dir = dir;
+    sp->budget = budget;
+    sp->runs = NULL;
+    sp->run_count = 0;
+    sp->run_capacity = 0;
+}
+
+static inline FILE* spill_open(const char* dir) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/groupby-spill-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("Cannot create spill file");
+        exit(1);
+    }
+    unlink(path);
+    FILE* f = fdopen(fd, "w+b");
+    if (!f) {
+        perror("Cannot open spill file");
+        exit(1);
+    }
+    setvbuf(f, NULL, _IOFBF, SPILL_IO_BUFFER);
+    return f;
+}
+
+static inline void spill_add_run(FILE*** runs, int* count, int* capacity, FILE* f) {
+    if (*count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        *runs = (FILE**)realloc(*runs, sizeof(FILE*) * *capacity);
+    }
+    (*runs)[(*count)++] = f;
+}
+
+static inline void run_write(FILE* f, const char* key, int count) {
+    size_t len = strlen(key);
+    fputc((int)len, f);
+    fwrite(key, 1, len, f);
+    fwrite(&count, sizeof(int), 1, f);
+}
+
+// 一个段写完后刷出缓冲区并检查写入是否出错（stdio 的错误标志会一直保留，
+// 中途任何一次 fputc/fwrite 失败都会在这里发现），出错即退出：
+// 写了一半的段读回时会被当成完整的段归并，悄悄丢掉后面的键
+static inline void run_finish(FILE* f) {
+    if (fflush(f) != 0 || ferror(f)) {
+        perror("Cannot write spill file");
+        exit(1);
+    }
+}
+
+static inline int run_read(RunReader* r) {
+    int len = fgetc(r->f);
+    if (len == EOF) return 0;
+    if (fread(r->rec.key, 1, len, r->f) != (size_t)len ||
+        fread(&r->rec.count, sizeof(int), 1, r->f) != 1) {
+        fprintf(stderr, "Spill file truncated\n");
+        exit(1);
+    }
+    r->rec.key[len] = '\0';
+    return 1;
+}
+
+// 把表中的条目按键排序后写成一个有序段
+static inline void spill_table(SpillSet* sp, HashMap* map) {
+    if (map->size == 0) return;
+    SortEntry* entries = (SortEntry*)malloc(sizeof(SortEntry) * map->size);
+    int n = 0;
+    for (unsigned int i = 0; i < map->capacity; i++) {
+        Slot* s = &map->slots[i];
+        if (!s->key) continue;
+        entries[n].key = s->key;
+        entries[n].count = s->count;
+        n++;
+    }
+    sort_by_key(entries, n);
+
+    FILE* f = spill_open(sp->dir);
+    for (int i = 0; i < n; i++) run_write(f, entries[i].key, entries[i].count);
+    run_finish(f);
+    spill_add_run(&sp->runs, &sp->run_count, &sp->run_capacity, f);
+    free(entries);
+}
+
+static inline int run_less_key(const RunReader* a, const RunReader* b) {
+    return strcmp(a->rec.key, b->rec.key) < 0;
+}
+
+static inline int run_less_value(const RunReader* a, const RunReader* b) {
+    if (a->rec.count != b->rec.count) return a->rec.count > b->rec.count;
+    return strcmp(a->rec.key, b->rec.key) < 0;
+}
+
+static inline void run_heap_down(RunReader** h, int n, int i,
+                                 int (*less)(const RunReader*, const RunReader*)) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && less(h[l], h[m])) m = l;
+        if (r < n && less(h[r], h[m])) m = r;
+        if (m == i) return;
+        RunReader* t = h[i];
+        h[i] = h[m];
+        h[m] = t;
+        i = m;
+    }
+}
+
+// 多路归并的小根堆：建堆时每个段先读入第一条记录，空段不进堆
+static inline int run_heap_build(RunReader* readers, RunReader** heap, FILE** runs, int count,
+                                 int (*less)(const RunReader*, const RunReader*)) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        rewind(runs[i]);
+        readers[i].f = runs[i];
+        if (run_read(&readers[i])) heap[n++] = &readers[i];
+    }
+    for (int i = n / 2 - 1; i >= 0; i--) run_heap_down(heap, n, i, less);
+    return n;
+}
+
+// 取出堆顶记录并让该段前进一条，堆空返回 0
+static inline int run_heap_pop(RunReader** heap, int* n, SpillRecord* out,
+                               int (*less)(const RunReader*, const RunReader*)) {
+    if (*n == 0) return 0;
+    RunReader* top = heap[0];
+    *out = top->rec;
+    if (!run_read(top)) heap[0] = heap[--*n];
+    run_heap_down(heap, *n, 0, less);
+    return 1;
+}
+
+static inline void spill_flush_batch(SpillRecord* batch, int n, SortEntry* refs,
+                                     FILE*** runs, int* run_count, int* run_capacity,
+                                     const char* dir) {
+    for (int i = 0; i < n; i++) {
+        refs[i].key = batch[i].key;
+        refs[i].count = batch[i].count;
+    }
+    sort_by_count(refs, n);
+    FILE* f = spill_open(dir);
+    for (int i = 0; i < n; i++) run_write(f, refs[i].key, refs[i].count);
+    run_finish(f);
+    spill_add_run(runs, run_count, run_capacity, f);
+}
+
+// 归并所有段并写出结果；top_k > 0 时只写前 top_k 个。返回不重复键的总数
+static inline int spill_finish(SpillSet* sp, const char* output_file, int top_k) {
+    // 第 1、2 步：按键归并并累加，按预算分批排序后写成按次数有序的段
+    int batch_cap = (int)(sp->budget / (sizeof(SpillRecord) + sizeof(SortEntry)));
+    if (batch_cap < 1024) batch_cap = 1024;
+    SpillRecord* batch = (SpillRecord*)malloc(sizeof(SpillRecord) * batch_cap);
+    SortEntry* refs = (SortEntry*)malloc(sizeof(SortEntry) * batch_cap);
+    FILE** value_runs = NULL;
+    int value_count = 0, value_capacity = 0;
+    int batch_n = 0;
+    int unique_total = 0;
+
+    RunReader* readers = (RunReader*)malloc(sizeof(RunReader) * (sp->run_count > 0 ? sp->run_count : 1));
+    RunReader** heap = (RunReader**)malloc(sizeof(RunReader*) * (sp->run_count > 0 ? sp->run_count : 1));
+    int heap_n = run_heap_build(readers, heap, sp->runs, sp->run_count, run_less_key);
+
+    SpillRecord rec;
+    int have = run_heap_pop(heap, &heap_n, &batch[batch_n], run_less_key);
+    while (have) {
+        have = run_heap_pop(heap, &heap_n, &rec, run_less_key);
+        if (have && strcmp(rec.key, batch[batch_n].key) == 0) {
+            batch[batch_n].count += rec.count;
+            continue;
+        }
+        batch_n++;
+        unique_total++;
+        if (batch_n == batch_cap) {
+            spill_flush_batch(batch, batch_n, refs, &value_runs, &value_count, &value_capacity, sp->dir);
+            batch_n = 0;
+        }
+        if (have) batch[batch_n] = rec;
+    }
+    if (batch_n > 0) {
+        spill_flush_batch(batch, batch_n, refs, &value_runs, &value_count, &value_capacity, sp->dir);
+    }
+    for (int i = 0; i < sp->run_count; i++) fclose(sp->runs[i]);
+    free(sp->runs);
+    sp->runs = NULL;
+    sp->run_count = sp->run_capacity = 0;
+    free(batch);
+    free(refs);
+    free(readers);
+    free(heap);
+
+    // 第 3 步：按 (次数降序, 键升序) 归并写出。归并是流式的，输出不整体缓存，
+    // 经由 TextBlock 成块 pwrite（见 result_file.h）
+    int fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Cannot open output file");
+        exit(1);
+    }
+    int written = top_k > 0 && top_k < unique_total ? top_k : unique_total;
+    char header[16];
+    int header_len = snprintf(header, sizeof(header), "%d\n", written);
+    TextBlock out;
+    text_block_init(&out, fd, header_len);
+    if (result_pwrite_all(fd, header, header_len, 0) != 0) out.error = errno;
+
+    readers = (RunReader*)malloc(sizeof(RunReader) * (value_count > 0 ? value_count : 1));
+    heap = (RunReader**)malloc(sizeof(RunReader*) * (value_count > 0 ? value_count : 1));
+    heap_n = run_heap_build(readers, heap, value_runs, value_count, run_less_value);
+    for (int i = 0; i < written && !out.error && run_heap_pop(heap, &heap_n, &rec, run_less_value); i++) {
+        text_block_line(&out, rec.key, strlen(rec.key), rec.count);
+    }
+    int err = text_block_finish(&out);
+    if (close(fd) != 0 && !err) err = errno;
+    if (err) {
+        errno = err;
+        perror("Cannot write output file");
+        exit(1);
+    }
+
+    for (int i = 0; i < value_count; i++) fclose(value_runs[i]);
+    free(value_runs);
+    free(readers);
+    free(heap);
+    return unique_total;
+}
+
+#endif
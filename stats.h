@@ -0,0 +1,197 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 热路径计时与计数，以 -DGROUPBY_STATS 编译时启用；未定义时下面的宏全部展开为空，
+// 不产生任何代码。
+// 每个线程第一次记录时领取一个独占的槽（按缓存行对齐，互不干扰），之后只写自己的槽，
+// 不需要原子操作；汇总在所有并行区结束后进行。计时为墙钟时间，跨文件累计。
+//   阶段：read（映射/读入）、count（解析+计数）、merge、sort、write
+//   计数：查找次数、新键数、探测步数与最长探测、扩容次数、MPI 收发字节数
+// 报告为 JSON：各线程（MPI 为各进程）的阶段耗时与计数，以及每个阶段的负载不均衡度
+// max / avg（只统计该阶段有记录的线程或进程）。
+
+enum {
+    STAT_READ,
+    STAT_COUNT,
+    STAT_MERGE,
+    STAT_SORT,
+    STAT_WRITE,
+    STAT_PHASES
+};
+
+enum {
+    STAT_LOOKUPS,       // 哈希表插入/累加的次数
+    STAT_NEW_KEYS,      // 其中新键的个数
+    STAT_PROBES,        // 越过的非目标槽位总数（线性探测的额外步数）
+    STAT_PROBE_MAX,     // 单次查找最长的探测步数
+    STAT_RESIZES,       // 扩容次数
+    STAT_BYTES_SENT,    // MPI 发送的字节数
+    STAT_BYTES_RECV,    // MPI 接收的字节数
+    STAT_COUNTERS
+};
+
+static const char* const stat_phase_names[STAT_PHASES] = {"read", "count", "merge", "sort", "write"};
+static const char* const stat_counter_names[STAT_COUNTERS] = {
+    "lookups", "new_keys", "probes", "probe_max", "resizes", "bytes_sent", "bytes_recv"
+};
+
+typedef struct {
+    double phase[STAT_PHASES];
+    unsigned long long counter[STAT_COUNTERS];
+} StatTotals;
+
+#ifdef GROUPBY_STATS
+
+#define STATS_MAX_THREADS 256
+
+typedef struct {
+    StatTotals t;
+} __attribute__((aligned(64))) StatSlot;
+
+static StatSlot stats_slots[STATS_MAX_THREADS];
+static int stats_next_slot = 0;
+static __thread StatSlot* stats_self = NULL;
+
+static inline StatSlot* stats_slot() {
+    if (!stats_self) {
+        int id = __atomic_fetch_add(&stats_next_slot, 1, __ATOMIC_RELAXED);
+        // 超出槽数的线程共用最后一个槽，计数可能略有误差
+        stats_self = &stats_slots[id < STATS_MAX_THREADS ? id : STATS_MAX_THREADS - 1];
+    }
+    return stats_self;
+}
+
+static inline double stats_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define STATS_ENABLED 1
+#define STATS_TIMER(name) double name = stats_now()
+#define STATS_ELAPSED(ph, name) (stats_slot()->t.phase[ph] += stats_now() - (name))
+#define STATS_ADD(c, v) (stats_slot()->t.counter[c] += (unsigned long long)(v))
+#define STATS_MAX(c, v) do { \
+        StatSlot* stats_s_ = stats_slot(); \
+        if ((unsigned long long)(v) > stats_s_->t.counter[c]) stats_s_->t.counter[c] = (unsigned long long)(v); \
+    } while (0)
+
+// 把 src 累加进 dst，probe_max 取最大值
+static inline void stats_accumulate(StatTotals* dst, const StatTotals* src) {
+    for (int p = 0; p < STAT_PHASES; p++) dst->phase[p] += src->phase[p];
+    for (int c = 0; c < STAT_COUNTERS; c++) {
+        if (c == STAT_PROBE_MAX) {
+            if (src->counter[c] > dst->counter[c]) dst->counter[c] = src->counter[c];
+        } else {
+            dst->counter[c] += src->counter[c];
+        }
+    }
+}
+
+// 记录过数据的线程数，各线程的统计在 stats_slots[0..n) 中
+static inline int stats_thread_count() {
+    int n = __atomic_load_n(&stats_next_slot, __ATOMIC_RELAXED);
+    return n < STATS_MAX_THREADS ? n : STATS_MAX_THREADS;
+}
+
+static inline void stats_write_totals(FILE* f, const StatTotals* t) {
+    fprintf(f, "{\"phases\": {");
+    for (int p = 0; p < STAT_PHASES; p++) {
+        fprintf(f, "%s\"%s\": %.6f", p ? ", " : "", stat_phase_names[p], t->phase[p]);
+    }
+    fprintf(f, "}, \"counters\": {");
+    for (int c = 0; c < STAT_COUNTERS; c++) {
+        fprintf(f, "%s\"%s\": %llu", c ? ", " : "", stat_counter_names[c], t->counter[c]);
+    }
+    fprintf(f, "}}");
+}
+
+// 各阶段的 max / avg 写入 out，只计该阶段耗时非零的项；没有记录的阶段为 0
+static inline void stats_imbalance(const StatTotals* items, int n, double* out) {
+    for (int p = 0; p < STAT_PHASES; p++) {
+        double sum = 0, max = 0;
+        int active = 0;
+        for (int i = 0; i < n; i++) {
+            double v = items[i].phase[p];
+            if (v <= 0) continue;
+            sum += v;
+            if (v > max) max = v;
+            active++;
+        }
+        out[p] = active ? max / (sum / active) : 0.0;
+    }
+}
+
+static inline void stats_write_imbalance(FILE* f, const double* imbalance) {
+    fprintf(f, "{");
+    for (int p = 0; p < STAT_PHASES; p++) {
+        fprintf(f, "%s\"%s\": %.4f", p ? ", " : "", stat_phase_names[p], imbalance[p]);
+    }
+    fprintf(f, "}");
+}
+
+// 本进程各线程的统计复制到 items（至少 stats_thread_count() 项），合计写入 total
+static inline int stats_collect(StatTotals* items, StatTotals* total) {
+    int n = stats_thread_count();
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < n; i++) {
+        items[i] = stats_slots[i].t;
+        stats_accumulate(total, &items[i]);
+    }
+    return n;
+}
+
+// 单进程的报告：各线程、合计与线程间不均衡度
+static inline void stats_write_report(FILE* f, const char* backend) {
+    StatTotals* items = (StatTotals*)calloc(STATS_MAX_THREADS, sizeof(StatTotals));
+    StatTotals total;
+    double imbalance[STAT_PHASES];
+    int n = stats_collect(items, &total);
+    stats_imbalance(items, n, imbalance);
+    fprintf(f, "{\"backend\": \"%s\", \"threads\": [", backend);
+    for (int i = 0; i < n; i++) {
+        if (i) fprintf(f, ", ");
+        stats_write_totals(f, &items[i]);
+    }
+    fprintf(f, "], \"total\": ");
+    stats_write_totals(f, &total);
+    fprintf(f, ", \"imbalance\": ");
+    stats_write_imbalance(f, imbalance);
+    fprintf(f, "}\n");
+    free(items);
+}
+
+#else
+
+#define STATS_ENABLED 0
+#define STATS_TIMER(name) ((void)0)
+#define STATS_ELAPSED(ph, name) ((void)0)
+#define STATS_ADD(c, v) ((void)(v))
+#define STATS_MAX(c, v) ((void)(v))
+
+#endif
+
+// 打开 --stats 指定的报告文件，"-" 为标准输出；未启用统计时提示并返回 NULL
+static inline FILE* stats_open(const char* path) {
+    if (!path) return NULL;
+#ifdef GROUPBY_STATS
+    if (strcmp(path, "-") == 0) return stdout;
+    FILE* f = fopen(path, "w");
+    if (!f) perror("Cannot open stats file");
+    return f;
+#else
+    fprintf(stderr, "--stats ignored: built without -DGROUPBY_STATS\n");
+    return NULL;
+#endif
+}
+
+static inline void stats_close(FILE* f) {
+    if (f && f != stdout) fclose(f);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "radix_sort.h"
+
+// 只保留按 (次数降序, 键升序) 排在最前的 K 个条目：容量为 K 的小根堆，
+// 堆顶是当前 K 个中排得最靠后的一个。每个候选 O(log K)，总计 O(U log K)。
+// 各线程/各进程分别维护自己的堆，最后把候选再放进一个堆即可合并。
+
+typedef struct {
+    SortEntry* data;
+    int size;
+    int capacity;
+} TopK;
+
+// a 排在 b 之后：次数更少，或次数相同而键更大
+static inline int topk_worse(const SortEntry* a, const SortEntry* b) {
+    if (a->count != b->count) return a->count < b->count;
+    return strcmp(a->key, b->key) > 0;
+}
+
+static inline void topk_init(TopK* t, int k) {
+    t->size = 0;
+    t->capacity = k;
+    t->data = (SortEntry*)malloc(sizeof(SortEntry) * (k > 0 ? k : 1));
+}
+
+static inline void topk_free(TopK* t) {
+    free(t->data);
+    t->data = NULL;
+    t->size = 0;
+}
+
+static inline void topk_sift_down(TopK* t, int i) {
+    SortEntry* a = t->data;
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, w = i;
+        if (l < t->size && topk_worse(&a[l], &a[w])) w = l;
+        if (r < t->size && topk_worse(&a[r], &a[w])) w = r;
+        if (w == i) return;
+        SortEntry tmp = a[i];
+        a[i] = a[w];
+        a[w] = tmp;
+        i = w;
+    }
+}
+
+static inline void topk_offer(TopK* t, const char* key, int count) {
+    if (t->capacity <= 0) return;
+    SortEntry e;
+    e.key = key;
+    e.count = count;
+
+    if (t->size < t->capacity) {
+        SortEntry* a = t->data;
+        int i = t->size++;
+        a[i] = e;
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!topk_worse(&a[i], &a[parent])) break;
+            SortEntry tmp = a[i];
+            a[i] = a[parent];
+            a[parent] = tmp;
+            i = parent;
+        }
+        return;
+    }
+
+    // 大多数候选次数低于堆顶，先比次数，免去 strcmp
+    if (count < t->data[0].count) return;
+    if (!topk_worse(&t->data[0], &e)) return;
+    t->data[0] = e;
+    topk_sift_down(t, 0);
+}
+
+// 把堆中的条目按 (次数降序, 键升序) 排好，返回条目数；之后 t->data 不再是堆
+static inline int topk_finish(TopK* t) {
+    sort_by_count(t->data, t->size);
+    return t->size;
+}
+
+#endif